@@ -24,10 +24,15 @@ bool AudioInterface::Create(string sOutputDevice, unsigned int nSampleRate, unsi
 	this->nChannels = nChannels;
 	this->nBlockCount = nBlocks;
 	this->nBlockSamples = nBlockSamples;
-	this->nBlockFree = nBlockCount;
+	this->nRenderAhead = nBlockCount;
+	this->nBlockQueued = 0;
 	this->nBlockCurrent = 0;
 	this->pBlockMemory = nullptr;
+	this->pMixBlock = nullptr;
 	this->pWaveHeaders = nullptr;
+	this->pBlockDone = nullptr;
+	this->bParked = false;
+	this->hBlockEvent = NULL;
 
 	//check device
 	vector<string> devices = GetDevices();
@@ -59,6 +64,9 @@ bool AudioInterface::Create(string sOutputDevice, unsigned int nSampleRate, unsi
 
 	ZeroMemory(pBlockMemory, sizeof(short) * nBlockCount * nChannels * nBlockSamples);
 
+	pMixBlock = new double[nChannels * nBlockSamples];
+	ZeroMemory(pMixBlock, sizeof(double) * nChannels * nBlockSamples);
+
 	pWaveHeaders = new WAVEHDR[nBlockCount];
 	if (pWaveHeaders == nullptr)
 	{
@@ -75,15 +83,15 @@ bool AudioInterface::Create(string sOutputDevice, unsigned int nSampleRate, unsi
 		pWaveHeaders[i].lpData = (LPSTR)(pBlockMemory + (i * nBlockSamples * nChannels));
 	}
 
+	//every block can be in flight at once, so the queue never overflows
+	pBlockDone = new SPSCQueue<unsigned int>(nBlockCount);
+	hBlockEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+
 
 	this->bReady = true;
 
 	audioThread = thread(&AudioInterface::MainThread, this);
 
-	//start the thread
-	unique_lock<mutex> lockMutex(muxBlockNotZero);
-	cvBlockNotZero.notify_one();
-
 	return true;
 }
 
@@ -94,6 +102,12 @@ void AudioInterface::Destroy()
 		delete[] pBlockMemory;
 		pBlockMemory = nullptr;
 	}
+
+	if (pMixBlock != nullptr)
+	{
+		delete[] pMixBlock;
+		pMixBlock = nullptr;
+	}
 		
 
 	if (pWaveHeaders != nullptr)
@@ -101,12 +115,24 @@ void AudioInterface::Destroy()
 		delete[] pWaveHeaders;
 		pWaveHeaders = nullptr;
 	}
-		
+
+	if (pBlockDone != nullptr)
+	{
+		delete pBlockDone;
+		pBlockDone = nullptr;
+	}
+
+	if (hBlockEvent != NULL)
+	{
+		CloseHandle(hBlockEvent);
+		hBlockEvent = NULL;
+	}
 }
 
 void AudioInterface::Stop()
 {
 	bReady = false;
+	SetEvent(hBlockEvent); //wake a parked render thread
 	audioThread.join();
 	waveOutReset(hwDevice);
 	MMRESULT mRes = waveOutClose(hwDevice);
@@ -133,14 +159,56 @@ void AudioInterface::Stop()
 	Destroy();
 }
 
+void AudioInterface::SetRenderAhead(unsigned int nBlocks)
+{
+	if (nBlocks < 1)
+		nBlocks = 1;
+	else if (nBlocks > nBlockCount)
+		nBlocks = nBlockCount;
+
+	nRenderAhead = nBlocks;
+}
+
+unsigned int AudioInterface::GetRenderAhead()
+{
+	return nRenderAhead;
+}
+
 double AudioInterface::ProcessSample(double dTime, byte)
 {
 	return 0.0;
 }
 
+//default block processing, renders each frame through userFunction or ProcessSample
+void AudioInterface::ProcessBlock(double *pBlock, unsigned int nFrames, unsigned int nChannels, uint64_t nStartFrame)
+{
+	for (unsigned int i = 0; i < nFrames; i++)
+	{
+		double dTime = (double)(nStartFrame + i) / (double)nSampleRate;
+
+		for (unsigned int n = 0; n < nChannels; n++)
+		{
+			if (userFunction == nullptr)
+				pBlock[i * nChannels + n] = ProcessSample(dTime, n);
+			else
+				pBlock[i * nChannels + n] = userFunction(dTime, n);
+		}
+	}
+}
+
 double AudioInterface::GetTime()
 {
-	return dGlobalTime;
+	return (double)nFrameClock.load() / (double)nSampleRate;
+}
+
+uint64_t AudioInterface::GetFrame()
+{
+	return nFrameClock.load();
+}
+
+unsigned int AudioInterface::GetSampleRate()
+{
+	return nSampleRate;
 }
 
 vector<string> AudioInterface::GetDevices()
@@ -174,6 +242,12 @@ void AudioInterface::SetUserFunction(double(*func)(double, byte))
 	this->userFunction = func;
 }
 
+//block function receives an interleaved buffer of nFrames * nChannels samples and the frame index of its first frame
+void AudioInterface::SetBlockFunction(void(*func)(double*, unsigned int, unsigned int, uint64_t))
+{
+	this->blockFunction = func;
+}
+
 const bool AudioInterface::GetActive()
 {
 	return bReady;
@@ -187,87 +261,99 @@ double AudioInterface::Clip(double dSample, double dMax)
 		return fmax(dSample, -dMax);
 }
 
-//Handler for processing next block of data
-void AudioInterface::waveOutProc(HWAVEOUT hWaveOut, UINT uMsg, DWORD dwParam1, DWORD dwParam2)
+//Handler for processing next block of data, runs on the driver thread and must not block
+void AudioInterface::waveOutProc(HWAVEOUT hWaveOut, UINT uMsg, DWORD_PTR dwParam1, DWORD_PTR dwParam2)
 {
 	if (uMsg != WOM_DONE)
 		return;
 
-	nBlockFree++;
-	unique_lock<mutex> lockMutex(muxBlockNotZero);
-	cvBlockNotZero.notify_one();
+	unsigned int nBlock = (unsigned int)((WAVEHDR*)dwParam1 - pWaveHeaders);
+	pBlockDone->Push(nBlock);
+
+	//the push has to be visible before bParked is read, pairs with the fence in WaitForBlock
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (bParked)
+		SetEvent(hBlockEvent);
 }
 
 //static wrapper for waveOutProc
-void CALLBACK AudioInterface::waveOutProcWrap(HWAVEOUT hWaveOut, UINT uMsg, DWORD dwInstance, DWORD dwParam1, DWORD dwParam2)
+void CALLBACK AudioInterface::waveOutProcWrap(HWAVEOUT hWaveOut, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2)
 {
 	((AudioInterface*)dwInstance)->waveOutProc(hWaveOut, uMsg, dwParam1, dwParam2);
 }
 
-//TODO:
 void AudioInterface::MainThread()
 {
-	dGlobalTime = 0.0;
-	double dTimeStep = 1.0 / (double)nSampleRate;
+	uint64_t nFrame = 0;
+	nFrameClock = 0;
 
 	double dMaxSample = (double)SHRT_MAX;
-	short *nPreviousSample = new short[nChannels];
-	ZeroMemory(nPreviousSample, sizeof(short) * nChannels);
 
 	while (bReady)
 	{
-		//wait until block available
-		if (nBlockFree == 0)
+		//collect blocks returned by the device
+		unsigned int nBlock;
+
+		while (pBlockDone->Pop(nBlock))
+			nBlockQueued--;
+
+		//wait until the device has room for another block
+		if (nBlockQueued >= nRenderAhead)
 		{
-			unique_lock<mutex> lockMutex(muxBlockNotZero);
-			cvBlockNotZero.wait(lockMutex);
+			WaitForBlock();
+			continue;
 		}
 
-		nBlockFree--;
-
 		//prepare block for processing
 		if (pWaveHeaders[nBlockCurrent].dwFlags & WHDR_PREPARED)
 		{
 			waveOutUnprepareHeader(hwDevice, &pWaveHeaders[nBlockCurrent], sizeof(WAVEHDR));
 		}
 
-		short *nNewSample = new short[nChannels];
-		ZeroMemory(nNewSample, sizeof(short)*nChannels);
+		//render the whole block at once
+		if (blockFunction != nullptr)
+			blockFunction(pMixBlock, nBlockSamples, nChannels, nFrame);
+		else
+			ProcessBlock(pMixBlock, nBlockSamples, nChannels, nFrame);
 
-		int nCurrentBlock = nBlockCurrent * nBlockSamples * nChannels;
+		short *pBlock = pBlockMemory + nBlockCurrent * nBlockSamples * nChannels;
 
-		for (unsigned int i = 0; i < nBlockSamples * nChannels; i += nChannels)
-		{
-			if (userFunction == nullptr)
-			{ 
-				for (unsigned int n = 0; n < nChannels; n++)
-					nNewSample[n] = (short)(Clip(ProcessSample(dGlobalTime, n), 1.0) * dMaxSample);
-			}				
-			else
-			{
-				for (unsigned int n = 0; n < nChannels; n++)
-					nNewSample[n] = (short)(Clip(userFunction(dGlobalTime, n), 1.0) * dMaxSample);
-			}	
-
-			//nNewSample[0] = 0;
-
-			for (unsigned int n = 0; n < nChannels; n++)
-			{
-				pBlockMemory[nCurrentBlock + i + n] = nNewSample[n];
-				nPreviousSample[n] = nNewSample[n];
-			}
-				
-			dGlobalTime = dGlobalTime + dTimeStep;
-		}
+		//a limiter in the block function keeps the samples under full scale, clipping only guards the conversion
+		for (unsigned int i = 0; i < nBlockSamples * nChannels; i++)
+			pBlock[i] = (short)(Clip(pMixBlock[i], 1.0) * dMaxSample);
+
+		//publish the clock once per block
+		nFrame += nBlockSamples;
+		nFrameClock.store(nFrame, memory_order_release);
 
 		//send block to sound device
 		waveOutPrepareHeader(hwDevice, &pWaveHeaders[nBlockCurrent], sizeof(WAVEHDR));
 		waveOutWrite(hwDevice, &pWaveHeaders[nBlockCurrent], sizeof(WAVEHDR));
 		nBlockCurrent++;
 		nBlockCurrent %= nBlockCount;
+		nBlockQueued++;
+	}
+}
 
-		delete[] nNewSample;
+//spin briefly on the block queue, then park on the event until waveOutProc returns a block
+void AudioInterface::WaitForBlock()
+{
+	for (unsigned int i = 0; i < BLOCK_SPIN_COUNT; i++)
+	{
+		if (!pBlockDone->Empty() || !bReady)
+			return;
+
+		YieldProcessor();
 	}
 
-	delete[] nPreviousSample;
+	//publish the parked flag before the final check so a block returned in between still signals the event,
+	//with the fence in waveOutProc either this check sees the block or waveOutProc sees the flag
+	bParked = true;
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (pBlockDone->Empty() && bReady)
+		WaitForSingleObject(hBlockEvent, BLOCK_PARK_TIMEOUT);
+
+	bParked = false;
 }
\ No newline at end of file
@@ -2,12 +2,17 @@
 
 
 #include <vector>
+#include <cstdint>
 #include <string>
 #include <atomic>
 #include <thread>
-#include <condition_variable>
 #include <Windows.h>
 
+#include "SPSCQueue.h"
+
+#define BLOCK_SPIN_COUNT 2000 //polls of the block queue before the render thread parks
+#define BLOCK_PARK_TIMEOUT 50 //ms, upper bound for a parked render thread
+
 
 
 class AudioInterface
@@ -19,10 +24,16 @@ public:
 	bool Create(std::string sOutputDevice, unsigned int nSampleRate = 44100, unsigned int nChannels = 1, unsigned int nBlocks = 8, unsigned int nBlockSamples = 512);
 	void Destroy();
 	void SetUserFunction(double(*func)(double, byte));
+	void SetBlockFunction(void(*func)(double*, unsigned int, unsigned int, uint64_t));
 	double Clip(double dSample, double dMax);
 	void Stop();
+	void SetRenderAhead(unsigned int nBlocks); //number of blocks queued at the device ahead of playback
+	unsigned int GetRenderAhead();
 	virtual double ProcessSample(double dTime, byte channel); //override to process current sample
-	double GetTime();
+	virtual void ProcessBlock(double *pBlock, unsigned int nFrames, unsigned int nChannels, uint64_t nStartFrame); //override to process a block of interleaved frames
+	double GetTime(); //seconds since start, derived from the frame clock
+	uint64_t GetFrame(); //frames rendered since start, updated once per block
+	unsigned int GetSampleRate();
 	const bool GetActive();
 	int GetActiveDevice();
 
@@ -31,6 +42,7 @@ public:
 
 private:
 	double(*userFunction)(double, byte) = nullptr;
+	void(*blockFunction)(double*, unsigned int, unsigned int, uint64_t) = nullptr;
 
 	unsigned int nSampleRate;
 	unsigned int nChannels;
@@ -39,19 +51,24 @@ private:
 	unsigned int nBlockCurrent;
 
 	short *pBlockMemory;
+	double *pMixBlock; //interleaved render target for one block, converted into pBlockMemory
 	WAVEHDR *pWaveHeaders;
 	HWAVEOUT hwDevice;
 
 	std::thread audioThread;
 	std::atomic <bool> bReady;
-	std::atomic <unsigned int> nBlockFree;
-	std::condition_variable cvBlockNotZero;
-	std::mutex muxBlockNotZero;
+	std::atomic <unsigned int> nRenderAhead;
+	unsigned int nBlockQueued; //blocks written to the device and not yet returned, render thread only
+
+	SPSCQueue<unsigned int> *pBlockDone; //indices of played blocks, pushed by waveOutProc
+	std::atomic <bool> bParked;
+	HANDLE hBlockEvent;
 
-	std::atomic <double> dGlobalTime;
+	std::atomic <uint64_t> nFrameClock; //canonical timeline of the engine
 
 	void MainThread();
-	void waveOutProc(HWAVEOUT hWaveOut, UINT uMsg, DWORD dwParam1, DWORD dwParam2);
+	void WaitForBlock();
+	void waveOutProc(HWAVEOUT hWaveOut, UINT uMsg, DWORD_PTR dwParam1, DWORD_PTR dwParam2);
 
-	static void CALLBACK waveOutProcWrap(HWAVEOUT hWaveOut, UINT uMsg, DWORD dwInstance, DWORD dwParam1, DWORD dwParam2);	
+	static void CALLBACK waveOutProcWrap(HWAVEOUT hWaveOut, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2);	
 };
\ No newline at end of file
@@ -0,0 +1,408 @@
+#include "Convolver.h"
+#include "WaveFile.h"
+#include "Oscillator.h"
+#include "SIMD.h"
+
+#include <cmath>
+#include <memory>
+#include <new>
+
+#define RESAMPLE_ZEROS 32 //zero crossings of the resampling sinc on each side
+
+//blackman windowed sinc interpolation, lowpassed below the lower of the two nyquists
+static std::vector<double> Resample(const std::vector<double> &in, double dRatio, size_t nMaxLength)
+{
+	size_t nLength = (size_t)(in.size() * dRatio);
+	std::vector<double> out(nLength < nMaxLength ? nLength : nMaxLength);
+	double dCutoff = dRatio < 1.0 ? dRatio : 1.0;
+	double dHalf = RESAMPLE_ZEROS / dCutoff; //half width of the window in input samples
+	long long nSize = (long long)in.size();
+
+	for (size_t n = 0; n < out.size(); n++)
+	{
+		double t = n / dRatio;
+		long long nFirst = (long long)ceil(t - dHalf);
+		long long nLast = (long long)floor(t + dHalf);
+		double dSum = 0.0;
+
+		if (nFirst < 0)
+			nFirst = 0;
+
+		if (nLast > nSize - 1)
+			nLast = nSize - 1;
+
+		for (long long k = nFirst; k <= nLast; k++)
+		{
+			double d = k - t;
+			double x = PI * d * dCutoff;
+			double u = d / dHalf;
+			double dWindow = 0.42 + 0.5 * cos(PI * u) + 0.08 * cos(PI_R * u);
+
+			dSum += in[(size_t)k] * (x == 0.0 ? 1.0 : sin(x) / x) * dWindow;
+		}
+
+		out[n] = dSum * dCutoff;
+	}
+
+	return out;
+}
+
+Convolver::Convolver()
+{
+	fft.SetSize(2 * CONVOLVER_PARTITION);
+	nStatus.store(CONVOLVER_EMPTY);
+}
+
+Convolver::~Convolver()
+{
+	if (loader.joinable())
+		loader.join();
+
+	impulse *p;
+
+	while (loaded.Pop(p))
+		delete p;
+
+	while (retired.Pop(p))
+		delete p;
+
+	delete pImpulse;
+}
+
+void Convolver::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+}
+
+void Convolver::SetMix(double dMix)
+{
+	this->dMix = dMix < 0.0 ? 0.0 : (dMix > 1.0 ? 1.0 : dMix);
+}
+
+double Convolver::GetMix()
+{
+	return dMix;
+}
+
+bool Convolver::Load(const std::string &sPath)
+{
+	if (nStatus.load() == CONVOLVER_LOADING)
+		return false;
+
+	if (loader.joinable())
+		loader.join();
+
+	nStatus.store(CONVOLVER_LOADING);
+	loader = std::thread(&Convolver::LoadThread, this, sPath, nSampleRate);
+
+	return true;
+}
+
+int Convolver::GetStatus()
+{
+	return nStatus.load();
+}
+
+//an exception must not leave the thread, a response too large for memory fails like any other
+void Convolver::LoadThread(std::string sPath, unsigned int nSampleRate)
+{
+	impulse *p = nullptr;
+
+	try
+	{
+		p = LoadImpulse(sPath, nSampleRate);
+	}
+	catch (const std::bad_alloc&)
+	{
+		p = nullptr;
+	}
+
+	if (p == nullptr)
+	{
+		nStatus.store(CONVOLVER_FAILED);
+		return;
+	}
+
+	//free what the audio thread handed back, then hand the new response over
+	impulse *pOld;
+
+	while (retired.Pop(pOld))
+		delete pOld;
+
+	if (!loaded.Push(p))
+	{
+		delete p;
+		nStatus.store(CONVOLVER_FAILED);
+		return;
+	}
+
+	nStatus.store(CONVOLVER_READY);
+}
+
+Convolver::impulse *Convolver::LoadImpulse(const std::string &sPath, unsigned int nSampleRate)
+{
+	std::vector<std::vector<double>> channels;
+	unsigned int nFileRate = 0;
+	size_t nMaxLength = (size_t)(CONVOLVER_MAX_LENGTH * nSampleRate);
+
+	//past the kept length only as much as the resampling window reaches, at most RESAMPLE_ZEROS frames at the lower rate
+	if (!LoadWave(sPath, channels, nFileRate, CONVOLVER_MAX_LENGTH + RESAMPLE_ZEROS / (double)nSampleRate, RESAMPLE_ZEROS + 1) || channels[0].empty())
+		return nullptr;
+
+	if (channels.size() > CONVOLVER_CHANNELS)
+		channels.resize(CONVOLVER_CHANNELS);
+
+	if (nFileRate != nSampleRate)
+	{
+		for (std::vector<double> &channel : channels)
+			channel = Resample(channel, nSampleRate / (double)nFileRate, nMaxLength);
+	}
+
+	size_t nLength = channels[0].size();
+
+	if (nLength > nMaxLength)
+		nLength = nMaxLength;
+
+	//unit energy per channel, so responses recorded at any level come out about as loud as the dry signal
+	double dEnergy = 0.0;
+
+	for (std::vector<double> &channel : channels)
+	{
+		for (size_t n = 0; n < nLength; n++)
+			dEnergy += channel[n] * channel[n];
+	}
+
+	dEnergy /= channels.size();
+
+	if (dEnergy <= 0.0)
+		return nullptr;
+
+	double dScale = 1.0 / sqrt(dEnergy);
+	unsigned int nChannels = (unsigned int)channels.size();
+	unsigned int nPartitions = nLength > CONVOLVER_PARTITION ? (unsigned int)((nLength - 1) / CONVOLVER_PARTITION) : 0;
+
+	std::unique_ptr<impulse> p(new impulse);
+
+	p->nChannels = nChannels;
+	p->nPartitions = nPartitions;
+	p->dHead.assign(nChannels * CONVOLVER_PARTITION, 0.0);
+	p->dSpectrumRe.assign((size_t)nChannels * nPartitions * CONVOLVER_BINS, 0.0);
+	p->dSpectrumIm.assign((size_t)nChannels * nPartitions * CONVOLVER_BINS, 0.0);
+
+	FFT fftLoad;
+	std::vector<double> dSegment(2 * CONVOLVER_PARTITION);
+
+	fftLoad.SetSize(2 * CONVOLVER_PARTITION);
+
+	for (unsigned int c = 0; c < nChannels; c++)
+	{
+		const std::vector<double> &h = channels[c];
+
+		for (size_t j = 0; j < CONVOLVER_PARTITION && j < nLength; j++)
+			p->dHead[c * CONVOLVER_PARTITION + j] = h[j] * dScale;
+
+		//every partition zero padded to twice its length
+		for (unsigned int n = 0; n < nPartitions; n++)
+		{
+			size_t nStart = (size_t)(n + 1) * CONVOLVER_PARTITION;
+			size_t nSpectrum = ((size_t)c * nPartitions + n) * CONVOLVER_BINS;
+
+			for (size_t j = 0; j < 2 * CONVOLVER_PARTITION; j++)
+				dSegment[j] = (j < CONVOLVER_PARTITION && nStart + j < nLength) ? h[nStart + j] * dScale : 0.0;
+
+			fftLoad.Forward(dSegment.data(), &p->dSpectrumRe[nSpectrum], &p->dSpectrumIm[nSpectrum]);
+		}
+	}
+
+	p->dHistory.assign(CONVOLVER_CHANNELS * 2 * CONVOLVER_PARTITION, 0.0);
+	p->dInput.assign(CONVOLVER_CHANNELS * 2 * CONVOLVER_PARTITION, 0.0);
+	p->dDelayRe.assign((size_t)CONVOLVER_CHANNELS * nPartitions * CONVOLVER_BINS, 0.0);
+	p->dDelayIm.assign((size_t)CONVOLVER_CHANNELS * nPartitions * CONVOLVER_BINS, 0.0);
+	p->dTail.assign(CONVOLVER_CHANNELS * CONVOLVER_PARTITION, 0.0);
+	p->dAccRe.assign(CONVOLVER_CHANNELS * CONVOLVER_BINS, 0.0);
+	p->dAccIm.assign(CONVOLVER_CHANNELS * CONVOLVER_BINS, 0.0);
+	p->nHistoryPos = 0;
+	p->nDelayPos = 0;
+	p->nPos = 0;
+	p->nAccumulated = 0;
+
+	return p.release();
+}
+
+//the head runs per frame against the newest inputs, the tail of the current partition was computed at the end of the last one
+template <class V>
+void Convolver::Render(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels)
+{
+	typedef typename V::T T;
+
+	impulse &ir = *pImpulse;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nStride;
+		unsigned int nPos = ir.nHistoryPos > 0 ? ir.nHistoryPos - 1 : CONVOLVER_PARTITION - 1;
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			const double *pHead = ir.dHead.data() + (c < ir.nChannels ? c : 0) * CONVOLVER_PARTITION;
+			double *pHistory = ir.dHistory.data() + c * 2 * CONVOLVER_PARTITION;
+			double x = pFrame[c];
+
+			pHistory[nPos] = x;
+			pHistory[nPos + CONVOLVER_PARTITION] = x;
+
+			T acc = V::Set(0.0);
+
+			for (int j = 0; j < CONVOLVER_PARTITION; j += V::N)
+				acc = V::Add(acc, V::Mul(V::Load(pHead + j), V::Load(pHistory + nPos + j)));
+
+			double dWet = V::Sum(acc) + ir.dTail[c * CONVOLVER_PARTITION + ir.nPos];
+
+			ir.dInput[c * 2 * CONVOLVER_PARTITION + CONVOLVER_PARTITION + ir.nPos] = x;
+			pFrame[c] += dMix * (dWet - pFrame[c]);
+		}
+
+		ir.nHistoryPos = nPos;
+
+		//the older partitions' share of this frame, all of them by the last frame of the partition
+		if (ir.nPartitions > 1)
+			Accumulate<V>(ir, nChannels, (ir.nPartitions - 1) * (ir.nPos + 1) / CONVOLVER_PARTITION);
+
+		if (++ir.nPos == CONVOLVER_PARTITION)
+		{
+			Partition<V>(ir, nChannels);
+			ir.nPos = 0;
+		}
+	}
+
+	V::End();
+}
+
+//complex multiply-add of an input spectrum and a response spectrum into the sums
+template <class V>
+static void MultiplyAdd(const double *xRe, const double *xIm, const double *hRe, const double *hIm, double *pAccRe, double *pAccIm)
+{
+	typedef typename V::T T;
+
+	for (int i = 0; i < CONVOLVER_PARTITION + 1; i += V::N)
+	{
+		T aRe = V::Load(xRe + i);
+		T aIm = V::Load(xIm + i);
+		T bRe = V::Load(hRe + i);
+		T bIm = V::Load(hIm + i);
+
+		V::Store(pAccRe + i, V::Add(V::Load(pAccRe + i), V::Sub(V::Mul(aRe, bRe), V::Mul(aIm, bIm))));
+		V::Store(pAccIm + i, V::Add(V::Load(pAccIm + i), V::Add(V::Mul(aRe, bIm), V::Mul(aIm, bRe))));
+	}
+}
+
+//tail partitions 1 to nUntil against the input spectra they meet at the next boundary, which are all in the ring already.
+//The next boundary writes the newest spectrum one slot back, partition n meets the one n slots after it.
+template <class V>
+void Convolver::Accumulate(impulse &ir, unsigned int nChannels, unsigned int nUntil)
+{
+	unsigned int nPartitions = ir.nPartitions;
+
+	if (ir.nAccumulated >= nUntil)
+		return;
+
+	unsigned int nNext = ir.nDelayPos > 0 ? ir.nDelayPos - 1 : nPartitions - 1;
+
+	for (unsigned int c = 0; c < nChannels; c++)
+	{
+		size_t nDelay = (size_t)c * nPartitions * CONVOLVER_BINS;
+		size_t nSpectrum = (size_t)(c < ir.nChannels ? c : 0) * nPartitions * CONVOLVER_BINS;
+		unsigned int nSlot = nNext + ir.nAccumulated + 1;
+
+		for (unsigned int n = ir.nAccumulated + 1; n <= nUntil; n++, nSlot++)
+		{
+			if (nSlot >= nPartitions)
+				nSlot -= nPartitions;
+
+			MultiplyAdd<V>(&ir.dDelayRe[nDelay + nSlot * CONVOLVER_BINS], &ir.dDelayIm[nDelay + nSlot * CONVOLVER_BINS],
+				&ir.dSpectrumRe[nSpectrum + n * CONVOLVER_BINS], &ir.dSpectrumIm[nSpectrum + n * CONVOLVER_BINS],
+				&ir.dAccRe[c * CONVOLVER_BINS], &ir.dAccIm[c * CONVOLVER_BINS]);
+		}
+	}
+
+	ir.nAccumulated = nUntil;
+}
+
+//overlap-save over the last two partitions of input, the spectra of older partitions wait in a ring
+//and every one of them meets the response partition that is as far into the tail as it is in the past
+template <class V>
+void Convolver::Partition(impulse &ir, unsigned int nChannels)
+{
+	unsigned int nPartitions = ir.nPartitions;
+
+	if (nPartitions == 0)
+		return;
+
+	Accumulate<V>(ir, nChannels, nPartitions - 1);
+
+	ir.nDelayPos = ir.nDelayPos > 0 ? ir.nDelayPos - 1 : nPartitions - 1;
+
+	for (unsigned int c = 0; c < nChannels; c++)
+	{
+		double *pInput = ir.dInput.data() + c * 2 * CONVOLVER_PARTITION;
+		double *pAccRe = &ir.dAccRe[c * CONVOLVER_BINS];
+		double *pAccIm = &ir.dAccIm[c * CONVOLVER_BINS];
+		size_t nDelay = (size_t)c * nPartitions * CONVOLVER_BINS + ir.nDelayPos * CONVOLVER_BINS;
+		size_t nSpectrum = (size_t)(c < ir.nChannels ? c : 0) * nPartitions * CONVOLVER_BINS;
+
+		fft.Forward(pInput, &ir.dDelayRe[nDelay], &ir.dDelayIm[nDelay]);
+
+		for (int j = 0; j < CONVOLVER_PARTITION; j++)
+			pInput[j] = pInput[j + CONVOLVER_PARTITION];
+
+		MultiplyAdd<V>(&ir.dDelayRe[nDelay], &ir.dDelayIm[nDelay], &ir.dSpectrumRe[nSpectrum], &ir.dSpectrumIm[nSpectrum], pAccRe, pAccIm);
+
+		//the second half holds the valid output, it plays during the next partition
+		fft.Inverse(pAccRe, pAccIm, dBlock);
+
+		for (int j = 0; j < CONVOLVER_PARTITION; j++)
+			ir.dTail[c * CONVOLVER_PARTITION + j] = dBlock[CONVOLVER_PARTITION + j];
+
+		for (int i = 0; i < CONVOLVER_BINS; i++)
+			pAccRe[i] = pAccIm[i] = 0.0;
+	}
+
+	ir.nAccumulated = 0;
+}
+
+struct convolverKernels
+{
+	static const Convolver::Kernel kernels[SIMD_AVX512 + 1];
+};
+
+const Convolver::Kernel convolverKernels::kernels[SIMD_AVX512 + 1] =
+{
+	&Convolver::Render<VecScalar>,
+	&Convolver::Render<VecSSE2>,
+	&Convolver::Render<VecAVX2>,
+	&Convolver::Render<VecAVX512>,
+};
+
+void Convolver::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	//swap in the newest loaded response, as long as the replaced one can be handed back
+	impulse *pLoaded;
+
+	while (retired.Size() < retired.Capacity() && loaded.Pop(pLoaded))
+	{
+		if (pImpulse)
+			retired.Push(pImpulse);
+
+		pImpulse = pLoaded;
+	}
+
+	if (!pImpulse || dMix <= 0.0)
+		return;
+
+	unsigned int nStride = nChannels;
+
+	if (nChannels > CONVOLVER_CHANNELS)
+		nChannels = CONVOLVER_CHANNELS;
+
+	(this->*convolverKernels::kernels[SIMDInstructionSet()])(pBlock, nFrames, nStride, nChannels);
+}
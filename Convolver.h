@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FFT.h"
+#include "SPSCQueue.h"
+
+#define CONVOLVER_PARTITION 256 //length of the direct head and of every FFT partition of the tail
+#define CONVOLVER_BINS (CONVOLVER_PARTITION + 8) //bins of a partition spectrum, padded to whole vectors
+#define CONVOLVER_CHANNELS 2
+#define CONVOLVER_MAX_LENGTH 10.0 //seconds of impulse response kept
+
+//loading states
+#define CONVOLVER_EMPTY 0
+#define CONVOLVER_LOADING 1
+#define CONVOLVER_READY 2
+#define CONVOLVER_FAILED 3
+
+//Convolution with impulse responses loaded from wave files, without latency.
+//The first CONVOLVER_PARTITION samples of the response are applied directly per frame,
+//the rest is split into partitions of the same length and applied by overlap-save FFT convolution
+//once per partition of input. The result is ready when the head no longer covers it.
+//Only the newest input partition meets the first tail partition at the boundary, the older ones are
+//multiplied and summed a share per frame during the partition before, so the boundary costs one FFT pair
+//and one multiply-add whatever the length, and the rest is spread evenly, bounded by CONVOLVER_MAX_LENGTH.
+//Responses are read, resampled, normalized and transformed on a background thread.
+//The finished response is handed to the audio thread through a wait-free queue and swapped in at the next block,
+//the replaced one goes back the same way and is freed by the next load, so the audio thread never allocates or frees.
+class Convolver
+{
+public:
+	Convolver();
+	~Convolver();
+
+	void SetSampleRate(unsigned int nSampleRate); //responses are resampled to the rate set when they are loaded
+	void SetMix(double dMix); //0 dry to 1 wet, 0 bypasses the convolution
+	double GetMix();
+
+	bool Load(const std::string &sPath); //starts loading in the background, false while another load is running
+	int GetStatus();
+
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place, channels past CONVOLVER_CHANNELS stay dry
+
+	typedef void (Convolver::*Kernel)(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels);
+
+private:
+	friend struct convolverKernels;
+
+	Convolver(const Convolver&) = delete;
+	Convolver &operator=(const Convolver&) = delete;
+
+	//a response with the processing state that depends on its length, swapped as a whole
+	struct impulse
+	{
+		unsigned int nChannels; //of the response, mono responses are used for every channel
+		unsigned int nPartitions; //of the tail
+
+		std::vector<double> dHead; //[response channel][CONVOLVER_PARTITION]
+		std::vector<double> dSpectrumRe; //[response channel][partition][CONVOLVER_BINS]
+		std::vector<double> dSpectrumIm;
+
+		//audio thread only
+		std::vector<double> dHistory; //[channel][2 * CONVOLVER_PARTITION] newest inputs, stored twice so the head reads them in one run
+		std::vector<double> dInput; //[channel][2 * CONVOLVER_PARTITION] last two partitions of input for overlap-save
+		std::vector<double> dDelayRe; //[channel][partition][CONVOLVER_BINS] spectra of the last nPartitions input partitions
+		std::vector<double> dDelayIm;
+		std::vector<double> dTail; //[channel][CONVOLVER_PARTITION] tail output during the current partition
+		std::vector<double> dAccRe; //[channel][CONVOLVER_BINS] tail spectrum of the next partition, summed during the current one
+		std::vector<double> dAccIm;
+		unsigned int nHistoryPos;
+		unsigned int nDelayPos;
+		unsigned int nPos; //frame within the current partition
+		unsigned int nAccumulated; //tail partitions from the second on already in the sums
+	};
+
+	impulse *pImpulse = nullptr; //in use by the audio thread
+	SPSCQueue<impulse*> loaded; //loader to audio thread
+	SPSCQueue<impulse*> retired; //audio thread back to the next loader
+
+	unsigned int nSampleRate = 44100;
+	double dMix = 0.0;
+
+	FFT fft; //audio thread only
+	double dBlock[2 * CONVOLVER_PARTITION];
+
+	std::thread loader;
+	std::atomic<int> nStatus;
+
+	void LoadThread(std::string sPath, unsigned int nSampleRate);
+	impulse *LoadImpulse(const std::string &sPath, unsigned int nSampleRate); //nullptr if the file can't be used, may throw std::bad_alloc
+
+	template <class V>
+	void Render(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels);
+	template <class V>
+	void Accumulate(impulse &ir, unsigned int nChannels, unsigned int nUntil);
+	template <class V>
+	void Partition(impulse &ir, unsigned int nChannels);
+};
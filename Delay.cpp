@@ -0,0 +1,198 @@
+#include "Delay.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+Delay::Delay()
+{
+	Reset();
+}
+
+Delay::~Delay()
+{
+}
+
+void Delay::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	//longest delay plus the interpolation taps
+	line.SetLength(DELAY_CHANNELS, (unsigned int)((DELAY_MAX_TIME + DELAY_MAX_MODULATION) * nSampleRate / 1000.0) + 4);
+
+	dDelay = -1.0; //starts at the first target instead of gliding up from 0
+
+	Reset();
+}
+
+void Delay::SetTime(double dTime)
+{
+	this->dTime = dTime < 0.0 ? 0.0 : (dTime > DELAY_MAX_TIME ? DELAY_MAX_TIME : dTime);
+}
+
+void Delay::SetTempo(double dTempo)
+{
+	if (dTempo > 0.0)
+		this->dTempo = dTempo;
+}
+
+void Delay::SetSync(double dBeats)
+{
+	dSync = dBeats > 0.0 ? dBeats : 0.0;
+}
+
+void Delay::SetFeedback(double dFeedback)
+{
+	this->dFeedback = dFeedback < 0.0 ? 0.0 : (dFeedback > 0.95 ? 0.95 : dFeedback);
+}
+
+void Delay::SetTone(double dFrequency)
+{
+	dTone = dFrequency;
+}
+
+void Delay::SetMix(double dMix)
+{
+	this->dMix = dMix < 0.0 ? 0.0 : (dMix > 1.0 ? 1.0 : dMix);
+}
+
+void Delay::SetPingPong(bool bPingPong)
+{
+	this->bPingPong = bPingPong;
+}
+
+void Delay::SetModulation(double dDepth, double dRate)
+{
+	this->dDepth = dDepth < 0.0 ? 0.0 : (dDepth > DELAY_MAX_MODULATION ? DELAY_MAX_MODULATION : dDepth);
+	this->dRate = dRate;
+}
+
+double Delay::GetTime()
+{
+	return dTime;
+}
+
+double Delay::GetTempo()
+{
+	return dTempo;
+}
+
+double Delay::GetSync()
+{
+	return dSync;
+}
+
+double Delay::GetFeedback()
+{
+	return dFeedback;
+}
+
+double Delay::GetTone()
+{
+	return dTone;
+}
+
+double Delay::GetMix()
+{
+	return dMix;
+}
+
+bool Delay::GetPingPong()
+{
+	return bPingPong;
+}
+
+void Delay::Reset()
+{
+	line.Reset();
+
+	for (int c = 0; c < DELAY_CHANNELS; c++)
+	{
+		dLowPass[c] = 0.0;
+		dHighPass[c] = 0.0;
+	}
+
+	dPhase = 0.0;
+}
+
+void Delay::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	if (line.GetLength() == 0)
+		return;
+
+	//channels past DELAY_CHANNELS stay dry
+	unsigned int nStride = nChannels;
+
+	if (nChannels > DELAY_CHANNELS)
+		nChannels = DELAY_CHANNELS;
+
+	//block constants, parameter changes from the GUI take effect at the next block
+	double dTarget = (dSync > 0.0 ? dSync * 60000.0 / dTempo : dTime) * nSampleRate / 1000.0;
+	double dModulation = dDepth * nSampleRate / 1000.0;
+	double dMax = (double)(line.GetLength() - 4) - 2.0 * dModulation;
+	double dSmooth = 1.0 - exp(-1000.0 / (DELAY_SMOOTHING * nSampleRate));
+	double dLowCoeff = 1.0 - exp(-PI_R * dTone / nSampleRate);
+	double dHighCoeff = 1.0 - exp(-PI_R * DELAY_LOW_CUT / nSampleRate);
+	double dIncrement = dRate / nSampleRate;
+	bool bPairs = bPingPong && nChannels > 1;
+
+	if (dTarget > dMax)
+		dTarget = dMax;
+
+	if (dDelay < 0.0)
+		dDelay = dTarget;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nStride;
+
+		dDelay += dSmooth * (dTarget - dDelay);
+
+		//the interpolation reads two samples past the read position, at least 3 samples keep it behind the write position
+		double dRead = dDelay;
+
+		if (dModulation > 0.0)
+		{
+			dRead += dModulation * (1.0 + sin(PI_R * dPhase));
+			dPhase += dIncrement;
+			dPhase -= floor(dPhase);
+		}
+
+		if (dRead < 3.0)
+			dRead = 3.0;
+
+		double dWet[DELAY_CHANNELS];
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			dWet[c] = line.Read(c, dRead);
+
+			//tone lowpass and low cut in the feedback path
+			dLowPass[c] += dLowCoeff * (dWet[c] - dLowPass[c]);
+			dHighPass[c] += dHighCoeff * (dLowPass[c] - dHighPass[c]);
+		}
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			double dIn = pFrame[c];
+			double dFilter;
+
+			//ping-pong feeds the pair's mono sum into its first line and crosses the repeats over
+			if (bPairs && (c | 1) < nChannels)
+			{
+				unsigned int nOther = c ^ 1;
+
+				dFilter = dLowPass[nOther] - dHighPass[nOther];
+				dIn = (c & 1) ? 0.0 : 0.5 * (pFrame[c] + pFrame[nOther]);
+			}
+			else
+				dFilter = dLowPass[c] - dHighPass[c];
+
+			line.Write(c, dIn + dFeedback * dFilter);
+		}
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			pFrame[c] += dMix * (dWet[c] - pFrame[c]);
+
+		line.Advance();
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "DelayLine.h"
+
+#define DELAY_CHANNELS 4 //ping-pong swaps channels 0/1 and 2/3
+#define DELAY_MAX_TIME 2000.0 //ms
+#define DELAY_MAX_MODULATION 20.0 //ms of depth on top of the longest time
+#define DELAY_SMOOTHING 50.0 //ms for a new delay time to settle, glides instead of clicking
+#define DELAY_LOW_CUT 80.0 //Hz, keeps the repeats from building up low end
+
+//Feedback delay on a DelayLine with a line per channel.
+//The read position is fractional so time changes and modulation glide smoothly.
+//Everything is processed a block at a time, the lines are allocated by SetSampleRate before audio starts.
+class Delay
+{
+public:
+	Delay();
+	~Delay();
+
+	void SetSampleRate(unsigned int nSampleRate); //allocates the lines
+	void SetTime(double dTime); //ms, used while not synced
+	void SetTempo(double dTempo); //bpm
+	void SetSync(double dBeats); //delay as note length in beats, 0 uses the free time
+	void SetFeedback(double dFeedback); //0 to 0.95
+	void SetTone(double dFrequency); //lowpass cutoff in the feedback path
+	void SetMix(double dMix); //0 dry to 1 wet
+	void SetPingPong(bool bPingPong);
+	void SetModulation(double dDepth, double dRate); //ms and Hz
+
+	double GetTime();
+	double GetTempo();
+	double GetSync();
+	double GetFeedback();
+	double GetTone();
+	double GetMix();
+	bool GetPingPong();
+
+	void Reset();
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place
+
+private:
+	Delay(const Delay&) = delete;
+	Delay &operator=(const Delay&) = delete;
+
+	DelayLine line;
+	unsigned int nSampleRate = 44100;
+
+	double dTime = 375.0;
+	double dTempo = 120.0;
+	double dSync = 0.0;
+	double dFeedback = 0.4;
+	double dTone = 6000.0;
+	double dMix = 0.0;
+	bool bPingPong = false;
+	double dDepth = 0.0;
+	double dRate = 0.5;
+
+	double dDelay = -1.0; //current delay in samples, follows the target smoothly
+	double dPhase = 0.0; //modulation lfo in cycles
+	double dLowPass[DELAY_CHANNELS];
+	double dHighPass[DELAY_CHANNELS];
+};
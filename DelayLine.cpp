@@ -0,0 +1,74 @@
+#include "DelayLine.h"
+
+#include <cmath>
+
+DelayLine::DelayLine()
+{
+}
+
+DelayLine::~DelayLine()
+{
+	delete[] pBuffer;
+}
+
+void DelayLine::SetLength(unsigned int nChannels, unsigned int nSamples)
+{
+	unsigned int nPower = 4;
+
+	while (nPower < nSamples)
+		nPower <<= 1;
+
+	delete[] pBuffer;
+	pBuffer = new double[nChannels * (nPower + DELAY_LINE_GUARD)];
+
+	this->nChannels = nChannels;
+	nSize = nPower;
+	nMask = nPower - 1;
+
+	Reset();
+}
+
+unsigned int DelayLine::GetLength()
+{
+	return nSize;
+}
+
+void DelayLine::Reset()
+{
+	for (unsigned int i = 0; i < nChannels * (nSize + DELAY_LINE_GUARD); i++)
+		pBuffer[i] = 0.0;
+
+	nWrite = 0;
+}
+
+//sample i of the ring is stored at i + 1, the last one again before the first and the first two again after the last
+void DelayLine::Write(unsigned int nChannel, double x)
+{
+	double *pLine = pBuffer + nChannel * (nSize + DELAY_LINE_GUARD);
+
+	pLine[nWrite + 1] = x;
+
+	if (nWrite == nMask)
+		pLine[0] = x;
+	else if (nWrite < 2)
+		pLine[nSize + 1 + nWrite] = x;
+}
+
+void DelayLine::Advance()
+{
+	nWrite = (nWrite + 1) & nMask;
+}
+
+double DelayLine::Read(unsigned int nChannel, double dDelay)
+{
+	double dPos = nWrite + nSize - dDelay;
+	double dFloor = floor(dPos);
+	double t = dPos - dFloor;
+	const double *p = pBuffer + nChannel * (nSize + DELAY_LINE_GUARD) + ((unsigned int)dFloor & nMask);
+
+	double c1 = 0.5 * (p[2] - p[0]);
+	double c2 = p[0] - 2.5 * p[1] + 2.0 * p[2] - 0.5 * p[3];
+	double c3 = 0.5 * (p[3] - p[0]) + 1.5 * (p[1] - p[2]);
+
+	return ((c3 * t + c2) * t + c1) * t + p[1];
+}
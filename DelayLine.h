@@ -0,0 +1,59 @@
+#pragma once
+
+#define DELAY_LINE_GUARD 3 //samples stored around each channel, one before and two after
+
+//Power of two ring buffer with a line per channel, read at fractional delays with 4 point hermite interpolation.
+//Each line is stored with copies of its ends around it, so the four samples around any read position are contiguous:
+//the scalar read needs no wrapping and the SIMD read fetches a lane per channel and delay with two gathers.
+//Delays count back from the frame that is written next, reads before that write need at least 3 samples.
+class DelayLine
+{
+public:
+	DelayLine();
+	~DelayLine();
+
+	void SetLength(unsigned int nChannels, unsigned int nSamples); //allocates, the length is rounded up to a power of two
+	unsigned int GetLength();
+	void Reset();
+
+	void Write(unsigned int nChannel, double x); //sample of the current frame
+	void Advance(); //moves all channels on to the next frame
+
+	double Read(unsigned int nChannel, double dDelay);
+	template <class V>
+	typename V::T Read(typename V::T channel, typename V::T delay); //channel and delay per lane
+
+private:
+	DelayLine(const DelayLine&) = delete;
+	DelayLine &operator=(const DelayLine&) = delete;
+
+	double *pBuffer = nullptr;
+	unsigned int nChannels = 0;
+	unsigned int nSize = 0;
+	unsigned int nMask = 0;
+	unsigned int nWrite = 0;
+};
+
+template <class V>
+typename V::T DelayLine::Read(typename V::T channel, typename V::T delay)
+{
+	typedef typename V::T T;
+
+	T size = V::Set((double)nSize);
+	T pos = V::Sub(V::Set((double)(nWrite + nSize)), delay);
+	T n = V::Floor(pos);
+	T t = V::Sub(pos, n);
+	T y0, y1, y2, y3;
+
+	n = V::Select(V::Less(n, size), n, V::Sub(n, size));
+	n = V::Add(n, V::Mul(channel, V::Set((double)(nSize + DELAY_LINE_GUARD))));
+
+	V::Gather(pBuffer, n, y0, y1);
+	V::Gather(pBuffer, V::Add(n, V::Set(2.0)), y2, y3);
+
+	T c1 = V::Mul(V::Set(0.5), V::Sub(y2, y0));
+	T c2 = V::Sub(V::Add(V::Sub(y0, V::Mul(V::Set(2.5), y1)), V::Mul(V::Set(2.0), y2)), V::Mul(V::Set(0.5), y3));
+	T c3 = V::Add(V::Mul(V::Set(0.5), V::Sub(y3, y0)), V::Mul(V::Set(1.5), V::Sub(y1, y2)));
+
+	return V::Add(V::Mul(V::Add(V::Mul(V::Add(V::Mul(c3, t), c2), t), c1), t), y1);
+}
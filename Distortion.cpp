@@ -0,0 +1,298 @@
+#include "Distortion.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+#define DIST_TABLE_SIZE ((int)(2.0 * DIST_RANGE * DIST_STEPS)) //intervals, the tables have one entry more
+
+static double dCurveTable[DIST_FOLDBACK + 1][2 * (DIST_TABLE_SIZE + 1)];
+
+static double CurveShape(int nCurve, double x)
+{
+	switch (nCurve)
+	{
+	case DIST_ATAN:
+		return (2.0 / PI) * atan(0.5 * PI * x);
+	case DIST_TANH:
+		return tanh(x);
+	case DIST_ASYMMETRIC:
+		return x >= 0.0 ? tanh(x) : 0.5 * tanh(2.0 * x);
+	case DIST_FOLDBACK:
+	{
+		//triangle with a period of 4, the table range holds whole periods
+		double y = x + 1.0 - 4.0 * floor((x + 1.0) / 4.0);
+
+		return y < 2.0 ? y - 1.0 : 3.0 - y;
+	}
+	}
+
+	return x;
+}
+
+//the antiderivative sums the trapezoids under the interpolated curve, zero at the center keeps its values small
+static bool BuildCurveTables()
+{
+	double h = 1.0 / DIST_STEPS;
+
+	for (int c = 0; c <= DIST_FOLDBACK; c++)
+	{
+		double *pTable = dCurveTable[c];
+
+		for (int i = 0; i <= DIST_TABLE_SIZE; i++)
+			pTable[2 * i] = CurveShape(c, -DIST_RANGE + i * h);
+
+		pTable[1] = 0.0;
+
+		for (int i = 1; i <= DIST_TABLE_SIZE; i++)
+			pTable[2 * i + 1] = pTable[2 * i - 1] + 0.5 * h * (pTable[2 * i - 2] + pTable[2 * i]);
+
+		double dCenter = pTable[DIST_TABLE_SIZE + 1];
+
+		for (int i = 0; i <= DIST_TABLE_SIZE; i++)
+			pTable[2 * i + 1] -= dCenter;
+	}
+
+	return true;
+}
+
+static bool bCurveTables = BuildCurveTables();
+
+Distortion::Distortion()
+{
+	bChanged.store(true);
+
+	Reset();
+}
+
+Distortion::~Distortion()
+{
+}
+
+void Distortion::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	bChanged = true;
+}
+
+void Distortion::SetCurve(int nCurve)
+{
+	this->nCurve = nCurve < DIST_OFF || nCurve > DIST_FOLDBACK ? DIST_OFF : nCurve;
+}
+
+void Distortion::SetDrive(double dDrive)
+{
+	this->dDrive = dDrive < 0.0 ? 0.0 : (dDrive > DIST_MAX_DRIVE ? DIST_MAX_DRIVE : dDrive);
+}
+
+void Distortion::SetBits(double dBits)
+{
+	this->dBits = dBits < 1.0 ? 1.0 : (dBits > DIST_MAX_BITS ? DIST_MAX_BITS : dBits);
+
+	bChanged = true;
+}
+
+void Distortion::SetCrushRate(double dRate)
+{
+	dCrushRate = dRate > 0.0 ? dRate : 0.0;
+
+	bChanged = true;
+}
+
+void Distortion::SetMix(double dMix)
+{
+	this->dMix = dMix < 0.0 ? 0.0 : (dMix > 1.0 ? 1.0 : dMix);
+}
+
+int Distortion::GetCurve()
+{
+	return nCurve;
+}
+
+double Distortion::GetDrive()
+{
+	return dDrive;
+}
+
+double Distortion::GetBits()
+{
+	return dBits;
+}
+
+double Distortion::GetCrushRate()
+{
+	return dCrushRate;
+}
+
+double Distortion::GetMix()
+{
+	return dMix;
+}
+
+void Distortion::Reset()
+{
+	for (unsigned int i = 0; i < DIST_LANES; i++)
+		Reset(i);
+
+	dHoldPhase = 0.0;
+}
+
+void Distortion::Reset(unsigned int nLane)
+{
+	if (nLane >= DIST_LANES)
+		return;
+
+	dLast[nLane] = 0.0;
+	dLastIntegral[nLane] = nTableCurve == DIST_OFF ? 0.0 : Integral(0.0);
+	dHeld[nLane] = 0.0;
+}
+
+//the quantizer scale and the hold step only change with their settings
+void Distortion::UpdateCrusher()
+{
+	if (dBits >= DIST_MAX_BITS)
+		dScale = dInvScale = 0.0;
+	else
+	{
+		dScale = pow(2.0, dBits - 1.0);
+		dInvScale = 1.0 / dScale;
+	}
+
+	dHoldStep = dCrushRate > 0.0 ? dCrushRate / nSampleRate : 1.0;
+}
+
+//the curve's table and the antiderivatives at the last inputs, which belong to the previous curve until now
+void Distortion::SetTable()
+{
+	nTableCurve = nCurve;
+	pTable = dCurveTable[nCurve];
+	bPeriodic = nCurve == DIST_FOLDBACK;
+
+	if (nCurve != DIST_OFF)
+	{
+		for (unsigned int i = 0; i < DIST_LANES; i++)
+			dLastIntegral[i] = Integral(dLast[i]);
+	}
+}
+
+double Distortion::Curve(double x)
+{
+	double u = (x + DIST_RANGE) * DIST_STEPS;
+
+	if (bPeriodic)
+		u -= DIST_TABLE_SIZE * floor(u / DIST_TABLE_SIZE);
+	else if (u <= 0.0)
+		return pTable[0];
+	else if (u >= DIST_TABLE_SIZE)
+		return pTable[2 * DIST_TABLE_SIZE];
+
+	int i = (int)u;
+	double t = u - i;
+
+	if (i >= DIST_TABLE_SIZE) //rounding at the end of a wrapped period
+	{
+		i = DIST_TABLE_SIZE - 1;
+		t = 1.0;
+	}
+
+	const double *p = pTable + 2 * i;
+
+	return p[0] + t * (p[2] - p[0]);
+}
+
+//the integral of the linearly interpolated curve, past the range it continues at the last slope
+double Distortion::Integral(double x)
+{
+	double u = (x + DIST_RANGE) * DIST_STEPS;
+
+	if (bPeriodic)
+		u -= DIST_TABLE_SIZE * floor(u / DIST_TABLE_SIZE); //whole periods of the curve integrate to zero
+	else if (u <= 0.0)
+		return pTable[1] + pTable[0] * (u / DIST_STEPS);
+	else if (u >= DIST_TABLE_SIZE)
+		return pTable[2 * DIST_TABLE_SIZE + 1] + pTable[2 * DIST_TABLE_SIZE] * ((u - DIST_TABLE_SIZE) / DIST_STEPS);
+
+	int i = (int)u;
+	double t = u - i;
+
+	if (i >= DIST_TABLE_SIZE)
+	{
+		i = DIST_TABLE_SIZE - 1;
+		t = 1.0;
+	}
+
+	const double *p = pTable + 2 * i;
+
+	return p[1] + (t / DIST_STEPS) * (p[0] + 0.5 * t * (p[2] - p[0]));
+}
+
+void Distortion::Process(double *pBlock, unsigned int nFrames, unsigned int nLanes)
+{
+	if (bChanged.exchange(false))
+		UpdateCrusher();
+
+	if (nCurve != nTableCurve)
+		SetTable();
+
+	bool bShape = nTableCurve != DIST_OFF;
+	bool bHold = dHoldStep < 1.0;
+
+	if ((!bShape && dScale == 0.0 && !bHold) || dMix <= 0.0 || nFrames == 0)
+		return;
+
+	unsigned int nStride = nLanes;
+
+	if (nLanes > DIST_LANES)
+		nLanes = DIST_LANES;
+
+	//the drive glides over the block, a step in the gain would be a step in the curve's input
+	double dTarget = pow(10.0, dDrive / 20.0);
+	double dGainStep = (dTarget - dGain) / nFrames;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nStride;
+		bool bTake = true;
+
+		dGain += dGainStep;
+
+		//a new sample whenever the phase wrapped, the first frame after a reset takes one
+		if (bHold)
+		{
+			bTake = dHoldPhase < dHoldStep;
+			dHoldPhase += dHoldStep;
+
+			if (dHoldPhase >= 1.0)
+				dHoldPhase -= 1.0;
+		}
+
+		for (unsigned int c = 0; c < nLanes; c++)
+		{
+			double dDry = pFrame[c];
+			double y = dDry;
+
+			if (bShape)
+			{
+				//the curve averaged over the step from the last input
+				double x = dGain * dDry;
+				double dIntegral = Integral(x);
+				double dx = x - dLast[c];
+
+				y = fabs(dx) > DIST_ADAA_MIN ? (dIntegral - dLastIntegral[c]) / dx : Curve(0.5 * (x + dLast[c]));
+
+				dLast[c] = x;
+				dLastIntegral[c] = dIntegral;
+			}
+
+			if (dScale > 0.0)
+				y = floor(y * dScale + 0.5) * dInvScale;
+
+			if (bTake)
+				dHeld[c] = y;
+
+			pFrame[c] = dDry + dMix * (dHeld[c] - dDry);
+		}
+	}
+
+	dGain = dTarget;
+}
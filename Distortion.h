@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+
+#define DIST_LANES 32 //interleaved lanes of a block, output channels on the bus or one per voice
+#define DIST_RANGE 16.0 //input range of the curve tables, past it the curves hold their last value
+#define DIST_STEPS 64 //table entries per unit of input
+#define DIST_ADAA_MIN 1e-5 //input steps below this use the curve at the midpoint instead of the antiderivative difference
+#define DIST_MAX_DRIVE 36.0 //dB
+#define DIST_MAX_BITS 24 //at this depth and above the quantizer is off
+
+//curves, all with unit slope at zero
+#define DIST_OFF 0
+#define DIST_ATAN 1
+#define DIST_TANH 2
+#define DIST_ASYMMETRIC 3 //tanh above zero, clips at half the level below, adds even harmonics
+#define DIST_FOLDBACK 4 //folds back at +-1 instead of clipping
+
+//Waveshaper and bitcrusher.
+//The curves and their antiderivatives are tables built once, the shaper outputs the difference of the
+//antiderivative between two inputs over their distance (first order ADAA), the average of the curve over the
+//step, which suppresses most of the aliasing without oversampling. The antiderivative table is the exact integral
+//of the linearly interpolated curve, so the difference stays consistent with the curve however small the step.
+//The crusher quantizes with a precomputed scale and holds samples to lower the rate.
+class Distortion
+{
+public:
+	Distortion();
+	~Distortion();
+
+	void SetSampleRate(unsigned int nSampleRate);
+	void SetCurve(int nCurve);
+	void SetDrive(double dDrive); //dB of gain into the curve, glides over a block
+	void SetBits(double dBits); //1 to DIST_MAX_BITS
+	void SetCrushRate(double dRate); //Hz the samples are held at, 0 or the sample rate and above to not hold
+	void SetMix(double dMix); //0 dry to 1 wet
+
+	int GetCurve();
+	double GetDrive();
+	double GetBits();
+	double GetCrushRate();
+	double GetMix();
+
+	void Reset();
+	void Reset(unsigned int nLane); //for a voice that restarts in its lane
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nLanes); //interleaved, in place
+
+private:
+	unsigned int nSampleRate = 44100;
+	int nCurve = DIST_OFF;
+	double dDrive = 0.0;
+	double dBits = DIST_MAX_BITS;
+	double dCrushRate = 0.0;
+	double dMix = 1.0;
+	std::atomic<bool> bChanged; //set by the setters, taken by Process
+
+	double dGain = 1.0; //drive reached at the end of the last block
+	double dScale = 0.0; //quantizer steps per unit, 0 when off
+	double dInvScale = 0.0;
+	double dHoldStep = 1.0; //crush rate over sample rate
+	double dHoldPhase = 0.0;
+
+	double dLast[DIST_LANES]; //last driven input of every lane
+	double dLastIntegral[DIST_LANES]; //antiderivative at it
+	double dHeld[DIST_LANES];
+
+	int nTableCurve = DIST_OFF;
+	const double *pTable = nullptr; //curve and antiderivative interleaved, pairs at DIST_STEPS per unit from -DIST_RANGE
+	bool bPeriodic = false;
+
+	double Curve(double x);
+	double Integral(double x);
+	void UpdateCrusher();
+	void SetTable();
+};
@@ -0,0 +1,346 @@
+#include "Dynamics.h"
+
+#include <cmath>
+
+Limiter::Limiter()
+{
+	dReduction.store(0.0);
+	bChanged.store(true);
+}
+
+Limiter::~Limiter()
+{
+	delete[] pDelay;
+	delete[] pQueueGain;
+	delete[] pQueueFrame;
+	delete[] pAverage;
+}
+
+void Limiter::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	nLookahead = (unsigned int)(LIMITER_LOOKAHEAD * nSampleRate / 1000.0 + 0.5);
+
+	if (nLookahead < 1)
+		nLookahead = 1;
+
+	nWindow = nLookahead + 1;
+
+	//the queue never holds more than a window
+	unsigned int nQueueSize = 2;
+
+	while (nQueueSize <= nWindow)
+		nQueueSize <<= 1;
+
+	delete[] pDelay;
+	delete[] pQueueGain;
+	delete[] pQueueFrame;
+	delete[] pAverage;
+
+	pDelay = new double[nLookahead * DYNAMICS_CHANNELS];
+	pQueueGain = new double[nQueueSize];
+	pQueueFrame = new unsigned int[nQueueSize];
+	pAverage = new double[nWindow];
+	nQueueMask = nQueueSize - 1;
+
+	bChanged = true;
+
+	Reset();
+}
+
+void Limiter::SetGain(double dGain)
+{
+	this->dGain = dGain < 0.0 ? 0.0 : (dGain > LIMITER_MAX_GAIN ? LIMITER_MAX_GAIN : dGain);
+
+	bChanged = true;
+}
+
+void Limiter::SetCeiling(double dCeiling)
+{
+	this->dCeiling = dCeiling > 0.0 ? 0.0 : dCeiling;
+
+	bChanged = true;
+}
+
+void Limiter::SetRelease(double dRelease)
+{
+	this->dRelease = dRelease < 1.0 ? 1.0 : dRelease;
+
+	bChanged = true;
+}
+
+double Limiter::GetGain()
+{
+	return dGain;
+}
+
+double Limiter::GetCeiling()
+{
+	return dCeiling;
+}
+
+double Limiter::GetRelease()
+{
+	return dRelease;
+}
+
+unsigned int Limiter::GetLatency()
+{
+	return nLookahead;
+}
+
+double Limiter::GetReduction()
+{
+	return dReduction.load();
+}
+
+void Limiter::Reset()
+{
+	for (unsigned int i = 0; i < nLookahead * DYNAMICS_CHANNELS; i++)
+		pDelay[i] = 0.0;
+
+	for (unsigned int i = 0; i < nWindow; i++)
+		pAverage[i] = 1.0;
+
+	nDelayPos = 0;
+	nQueueFront = nQueueBack = 0;
+	nFrame = 0;
+	dEnvelope = 1.0;
+	nAveragePos = 0;
+	dAverageSum = nWindow;
+
+	dReduction.store(0.0);
+}
+
+void Limiter::Update()
+{
+	dInputGain = pow(10.0, dGain / 20.0);
+	dCeilingGain = pow(10.0, dCeiling / 20.0);
+	dReleaseCoeff = 1.0 - exp(-1000.0 / (dRelease * nSampleRate));
+}
+
+//the gain of a frame is the average of the held minimum over the window, every value in it is at most the gain
+//the delayed frame needs, so the average is as well
+void Limiter::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	if (pDelay == nullptr || nChannels > DYNAMICS_CHANNELS)
+		return;
+
+	if (bChanged.exchange(false))
+		Update();
+
+	double dInvWindow = 1.0 / nWindow;
+	double dLowest = 1.0;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nChannels;
+		double *pDelayed = pDelay + nDelayPos * DYNAMICS_CHANNELS;
+		double x[DYNAMICS_CHANNELS];
+		double dPeak = 0.0;
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			x[c] = pFrame[c] * dInputGain;
+			dPeak = fmax(dPeak, fabs(x[c]));
+		}
+
+		double dNeeded = dPeak > dCeilingGain ? dCeilingGain / dPeak : 1.0;
+
+		//gains no lower than the new one can never be the minimum again
+		while (nQueueBack != nQueueFront && pQueueGain[(nQueueBack - 1) & nQueueMask] >= dNeeded)
+			nQueueBack--;
+
+		pQueueGain[nQueueBack & nQueueMask] = dNeeded;
+		pQueueFrame[nQueueBack & nQueueMask] = nFrame;
+		nQueueBack++;
+
+		if (nFrame - pQueueFrame[nQueueFront & nQueueMask] >= nWindow)
+			nQueueFront++;
+
+		double dHold = pQueueGain[nQueueFront & nQueueMask];
+
+		nFrame++;
+
+		//down at once, up with the release
+		dEnvelope = dHold < dEnvelope ? dHold : dEnvelope + dReleaseCoeff * (dHold - dEnvelope);
+
+		//the running sum is recomputed once per window so rounding can't build up
+		dAverageSum += dEnvelope - pAverage[nAveragePos];
+		pAverage[nAveragePos] = dEnvelope;
+
+		if (++nAveragePos == nWindow)
+		{
+			nAveragePos = 0;
+			dAverageSum = 0.0;
+
+			for (unsigned int i = 0; i < nWindow; i++)
+				dAverageSum += pAverage[i];
+		}
+
+		double g = dAverageSum * dInvWindow;
+
+		dLowest = fmin(dLowest, g);
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			pFrame[c] = pDelayed[c] * g;
+			pDelayed[c] = x[c];
+		}
+
+		if (++nDelayPos == nLookahead)
+			nDelayPos = 0;
+	}
+
+	dReduction.store(20.0 * log10(dLowest));
+}
+
+Compressor::Compressor()
+{
+	dReduction.store(0.0);
+	bChanged.store(true);
+}
+
+Compressor::~Compressor()
+{
+}
+
+void Compressor::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	bChanged = true;
+}
+
+void Compressor::SetThreshold(double dThreshold)
+{
+	this->dThreshold = dThreshold;
+}
+
+void Compressor::SetRatio(double dRatio)
+{
+	this->dRatio = dRatio < 1.0 ? 1.0 : (dRatio > COMP_MAX_RATIO ? COMP_MAX_RATIO : dRatio);
+}
+
+void Compressor::SetAttack(double dAttack)
+{
+	this->dAttack = dAttack < 0.1 ? 0.1 : dAttack;
+
+	bChanged = true;
+}
+
+void Compressor::SetRelease(double dRelease)
+{
+	this->dRelease = dRelease < 1.0 ? 1.0 : dRelease;
+
+	bChanged = true;
+}
+
+void Compressor::SetMakeup(double dMakeup)
+{
+	this->dMakeup = dMakeup;
+}
+
+double Compressor::GetThreshold()
+{
+	return dThreshold;
+}
+
+double Compressor::GetRatio()
+{
+	return dRatio;
+}
+
+double Compressor::GetAttack()
+{
+	return dAttack;
+}
+
+double Compressor::GetRelease()
+{
+	return dRelease;
+}
+
+double Compressor::GetMakeup()
+{
+	return dMakeup;
+}
+
+double Compressor::GetReduction()
+{
+	return dReduction.load();
+}
+
+void Compressor::Reset()
+{
+	dMeanSquare = 0.0;
+	dSmoothed = 0.0;
+	dLevel = 1.0;
+	dLevelStep = 0.0;
+	nRamp = 0;
+
+	dReduction.store(0.0);
+}
+
+void Compressor::Update()
+{
+	double dMs = nSampleRate / 1000.0;
+
+	dRmsCoeff = 1.0 - exp(-1.0 / (COMP_RMS_TIME * dMs));
+	dAttackCoeff = 1.0 - exp(-COMP_CONTROL_RATE / (dAttack * dMs));
+	dReleaseCoeff = 1.0 - exp(-COMP_CONTROL_RATE / (dRelease * dMs));
+}
+
+void Compressor::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	if (nChannels > DYNAMICS_CHANNELS)
+		return;
+
+	if (bChanged.exchange(false))
+		Update();
+
+	bool bOff = dRatio <= 1.0 && dMakeup == 0.0;
+	double dInvChannels = 1.0 / nChannels;
+	double dSlope = 1.0 - 1.0 / dRatio;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nChannels;
+
+		//gain for the next period from the level in dB
+		if (nRamp == 0)
+		{
+			//at 1:1 the gain releases back to unity first, the step to exactly 1 is inaudible
+			if (bOff && fabs(dLevel - 1.0) < COMP_BYPASS_STEP)
+			{
+				Reset();
+				return;
+			}
+
+			double dOver = 10.0 * log10(dMeanSquare) - dThreshold;
+			double dTarget = dOver > 0.0 ? dOver * dSlope : 0.0;
+
+			dSmoothed += (dTarget > dSmoothed ? dAttackCoeff : dReleaseCoeff) * (dTarget - dSmoothed);
+			dLevelStep = (pow(10.0, (dMakeup - dSmoothed) / 20.0) - dLevel) / COMP_CONTROL_RATE;
+			nRamp = COMP_CONTROL_RATE;
+		}
+
+		nRamp--;
+
+		double dSquares = 0.0;
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			dSquares += pFrame[c] * pFrame[c];
+
+		//the small offset keeps the mean out of denormals in silence
+		dMeanSquare += dRmsCoeff * (dSquares * dInvChannels + 1e-30 - dMeanSquare);
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			pFrame[c] *= dLevel;
+
+		dLevel += dLevelStep;
+	}
+
+	dReduction.store(-dSmoothed);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+
+#define DYNAMICS_CHANNELS 4 //blocks with more channels pass unchanged, the look-ahead can't delay the rest
+
+#define LIMITER_LOOKAHEAD 1.5 //ms, also the attack and the added latency
+#define LIMITER_CEILING -0.3 //dB
+#define LIMITER_RELEASE 80.0 //ms
+#define LIMITER_MAX_GAIN 24.0 //dB
+
+#define COMP_CONTROL_RATE 32 //frames between gain computations, the gain is ramped in between
+#define COMP_RMS_TIME 10.0 //ms, averaging time of the level detector
+#define COMP_MAX_RATIO 20.0
+#define COMP_BYPASS_STEP 0.001 //distance of the gain from unity, about 0.01 dB, at which a compressor set to 1:1 switches off
+
+//Look-ahead peak limiter for the master.
+//The gain every frame needs to stay under the ceiling goes through a sliding minimum as long as the look-ahead
+//(a monotonic queue, amortized O(1) per frame), a release and a moving average of the same length. The audio is
+//delayed by the look-ahead, so the gain has ramped down by the time a peak comes out and never goes over the ceiling.
+//All buffers are allocated by SetSampleRate before audio starts.
+class Limiter
+{
+public:
+	Limiter();
+	~Limiter();
+
+	void SetSampleRate(unsigned int nSampleRate); //allocates the look-ahead buffers
+	void SetGain(double dGain); //dB into the limiter, 0 to LIMITER_MAX_GAIN
+	void SetCeiling(double dCeiling); //dB, 0 at most
+	void SetRelease(double dRelease); //ms
+
+	double GetGain();
+	double GetCeiling();
+	double GetRelease();
+	unsigned int GetLatency(); //frames the output is delayed by
+	double GetReduction(); //dB of the deepest gain reduction in the last block, safe to read from any thread
+
+	void Reset();
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place, DYNAMICS_CHANNELS at most
+
+private:
+	unsigned int nSampleRate = 44100;
+	double dGain = 0.0;
+	double dCeiling = LIMITER_CEILING;
+	double dRelease = LIMITER_RELEASE;
+	std::atomic<bool> bChanged; //set by the setters, taken by Process
+
+	double dInputGain = 1.0;
+	double dCeilingGain = 1.0;
+	double dReleaseCoeff = 0.0;
+
+	unsigned int nLookahead = 0; //frames, the window of the minimum and the average is one longer
+	unsigned int nWindow = 0;
+	double *pDelay = nullptr; //look-ahead frames of every channel
+	unsigned int nDelayPos = 0;
+
+	//sliding minimum of the needed gain, gains only rise from the front to the back
+	double *pQueueGain = nullptr;
+	unsigned int *pQueueFrame = nullptr;
+	unsigned int nQueueMask = 0;
+	unsigned int nQueueFront = 0;
+	unsigned int nQueueBack = 0;
+	unsigned int nFrame = 0;
+
+	double dEnvelope = 1.0; //held minimum after the release
+	double *pAverage = nullptr; //the last nWindow envelope values
+	unsigned int nAveragePos = 0;
+	double dAverageSum = 0.0;
+
+	std::atomic<double> dReduction;
+
+	void Update();
+};
+
+//RMS compressor, stereo linked.
+//The mean square is tracked every frame, the gain is computed in dB every COMP_CONTROL_RATE frames
+//with attack and release and ramped in between, so logarithms run once per period.
+class Compressor
+{
+public:
+	Compressor();
+	~Compressor();
+
+	void SetSampleRate(unsigned int nSampleRate);
+	void SetThreshold(double dThreshold); //dB
+	void SetRatio(double dRatio); //1 to COMP_MAX_RATIO, 1 with no makeup bypasses once the gain released to unity
+	void SetAttack(double dAttack); //ms
+	void SetRelease(double dRelease); //ms
+	void SetMakeup(double dMakeup); //dB
+
+	double GetThreshold();
+	double GetRatio();
+	double GetAttack();
+	double GetRelease();
+	double GetMakeup();
+	double GetReduction(); //dB of gain, 0 or below, safe to read from any thread
+
+	void Reset();
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place, DYNAMICS_CHANNELS at most
+
+private:
+	unsigned int nSampleRate = 44100;
+	double dThreshold = -18.0;
+	double dRatio = 1.0;
+	double dAttack = 10.0;
+	double dRelease = 150.0;
+	double dMakeup = 0.0;
+	std::atomic<bool> bChanged; //set by the setters, taken by Process
+
+	double dRmsCoeff = 0.0;
+	double dAttackCoeff = 0.0; //per control period
+	double dReleaseCoeff = 0.0;
+
+	double dMeanSquare = 0.0;
+	double dSmoothed = 0.0; //gain reduction in dB after attack and release
+	double dLevel = 1.0; //gain applied to the current frame
+	double dLevelStep = 0.0;
+	unsigned int nRamp = 0;
+
+	std::atomic<double> dReduction;
+
+	void Update();
+};
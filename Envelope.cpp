@@ -1,19 +1,30 @@
 #include "Envelope.h"
 
-Envelope::Envelope()
+#include <cmath>
+
+Envelope::Envelope() : bGate(false), nTriggers(0)
 {
-	
 }
 
 Envelope::~Envelope()
 {
 }
 
+void Envelope::SetDelay(double dDelay)
+{
+	parameters.dDelay = dDelay;
+}
+
 void Envelope::SetAttack(double dAttack)
 {
 	parameters.dAttack = dAttack;
 }
 
+void Envelope::SetHold(double dHold)
+{
+	parameters.dHold = dHold;
+}
+
 void Envelope::SetDecay(double dDecay)
 {
 	parameters.dDecay = dDecay;
@@ -22,6 +33,9 @@ void Envelope::SetDecay(double dDecay)
 void Envelope::SetSustain(double dSustain)
 {
 	parameters.dSustain = dSustain;
+
+	if (nStage == ENV_SUSTAIN)
+		Enter(ENV_SUSTAIN);
 }
 
 void Envelope::SetRelease(double dRelease)
@@ -29,11 +43,45 @@ void Envelope::SetRelease(double dRelease)
 	parameters.dRelease = dRelease;
 }
 
+void Envelope::SetExponential(bool bExponential)
+{
+	parameters.bExponential = bExponential;
+}
+
+void Envelope::SetLoop(bool bLoop)
+{
+	parameters.bLoop = bLoop;
+}
+
+void Envelope::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+}
+
+//new times apply from the next segment on, a new sustain level right away
+void Envelope::SetParameters(const EnvelopeParameters &p)
+{
+	parameters = p;
+
+	if (nStage == ENV_SUSTAIN)
+		Enter(ENV_SUSTAIN);
+}
+
+double Envelope::GetDelay()
+{
+	return parameters.dDelay;
+}
+
 double Envelope::GetAttack()
 {
 	return parameters.dAttack;
 }
 
+double Envelope::GetHold()
+{
+	return parameters.dHold;
+}
+
 double Envelope::GetDecay()
 {
 	return parameters.dDecay;
@@ -49,77 +97,176 @@ double Envelope::GetRelease()
 	return parameters.dRelease;
 }
 
-double Envelope::GetAmplitude()
+bool Envelope::GetExponential()
 {
-	if (!bActive)
-		return 0.0;
+	return parameters.bExponential;
+}
 
-	clock_t time = std::clock();
+bool Envelope::GetLoop()
+{
+	return parameters.bLoop;
+}
 
-	
-	clock_t attack = (int)(parameters.dAttack * (double)CLOCKS_PER_SEC / 1000.0) + 1;
-	clock_t decay = (int)(parameters.dDecay * (double)CLOCKS_PER_SEC / 1000.0) + 1;
+EnvelopeParameters Envelope::GetParameters()
+{
+	return parameters;
+}
 
-	if ((time - dTriggerStartTime) <= attack && !bReleased) //Attack
-	{		
-		double k = (double)(time - dTriggerStartTime) / (double)attack;
+//coefficients that take the level from where it is to dTarget in exactly dTime ms (at least one sample).
+//The exponential form aims past the target by dRatio of the span, so after n samples the distance
+//to that point has shrunk by (dRatio / (1 + dRatio)) and the segment lands on the target.
+void Envelope::Segment(double dTarget, double dTime, double dRatio)
+{
+	double dSamples = floor(dTime * nSampleRate / 1000.0) + 1.0;
+
+	this->dTarget = dTarget;
+	nRemaining = (unsigned int)dSamples;
+
+	if (parameters.bExponential && dTarget != dLevel)
+	{
+		double dAim = dTarget + dRatio * (dTarget - dLevel);
 
-		return k;		
+		dMul = pow(dRatio / (1.0 + dRatio), 1.0 / dSamples);
+		dAdd = dAim * (1.0 - dMul);
 	}
-	else if (parameters.dSustain != 0.0 && !bReleased)//return decay and sustain amplitude
+	else
 	{
-		if ((time - dTriggerStartTime - attack) <= decay) //Decay
-		{
-			double k = (double)(time - dTriggerStartTime - attack) / (double)decay;
+		dMul = 1.0;
+		dAdd = (dTarget - dLevel) / dSamples;
+	}
+}
 
-			return 1.0 - (k * (1.0 - parameters.dSustain));
-		}
-		else
-			return parameters.dSustain;
+void Envelope::Enter(int nStage)
+{
+	this->nStage = nStage;
+
+	switch (nStage)
+	{
+	case ENV_DELAY:
+		dLevel = 0.0;
+		Segment(0.0, parameters.dDelay, ENV_ATTACK_RATIO);
+		break;
+	case ENV_ATTACK:
+		Segment(1.0, parameters.dAttack, ENV_ATTACK_RATIO);
+		break;
+	case ENV_HOLD:
+		Segment(1.0, parameters.dHold, ENV_ATTACK_RATIO);
+		break;
+	case ENV_DECAY:
+		Segment(parameters.dSustain, parameters.dDecay, ENV_DECAY_RATIO);
+		break;
+	case ENV_SUSTAIN:
+		//holds the level until the gate closes
+		dLevel = parameters.dSustain;
+		dTarget = dLevel;
+		dMul = 0.0;
+		dAdd = dLevel;
+		nRemaining = 0xFFFFFFFF;
+		break;
+	case ENV_RELEASE:
+		Segment(0.0, parameters.dRelease, ENV_DECAY_RATIO);
+		break;
+	default:
+		dLevel = 0.0;
+		dTarget = 0.0;
+		dMul = 0.0;
+		dAdd = 0.0;
+		nRemaining = 0xFFFFFFFF;
+		break;
 	}
-	else //calculate release amplitude
+}
+
+//pick up gate changes, a retrigger attacks from the current level instead of jumping to zero
+void Envelope::UpdateGate()
+{
+	uint32_t nTrigger = nTriggers.load(std::memory_order_acquire);
+
+	if (nTrigger != nTriggersSeen)
 	{
-		clock_t release = (int)(parameters.dRelease * (double)CLOCKS_PER_SEC/1000.0) + 1;
+		nTriggersSeen = nTrigger;
+		Enter(nStage == ENV_IDLE && parameters.dDelay > 0.0 ? ENV_DELAY : ENV_ATTACK);
+	}
 
-		if (bReleased)
-		{
-			if ((time - dTriggerEndTime) <= release)
-			{
-				double k = (double)(time - dTriggerEndTime) / (double)release;
+	if (!bGate.load(std::memory_order_relaxed) && nStage != ENV_IDLE && nStage != ENV_RELEASE)
+		Enter(ENV_RELEASE);
+}
 
-				return dTriggerEndAmplitude - k* dTriggerEndAmplitude;
-			}
-			else
-				bActive = false;
-		}
-		else
+double Envelope::GetAmplitude()
+{
+	return dLevel;
+}
+
+bool Envelope::IsActive()
+{
+	return nStage != ENV_IDLE;
+}
+
+void Envelope::Process(double *pGain, unsigned int nFrames)
+{
+	UpdateGate();
+
+	unsigned int i = 0;
+
+	while (i < nFrames)
+	{
+		//run the current segment as far as it goes, one multiply and one add per sample
+		unsigned int nRun = nFrames - i < nRemaining ? nFrames - i : nRemaining;
+		double dMul = this->dMul;
+		double dAdd = this->dAdd;
+		double dLevel = this->dLevel;
+
+		for (unsigned int n = 0; n < nRun; n++)
 		{
-			if ((time - dTriggerStartTime - attack) <= release)
-			{
-				double k = (double)(time - dTriggerStartTime + attack) / (double)release;
+			dLevel = dLevel * dMul + dAdd;
+			pGain[i + n] = dLevel;
+		}
+
+		this->dLevel = dLevel;
+		nRemaining -= nRun;
+		i += nRun;
+
+		if (nRemaining > 0)
+			break;
+
+		//segment done, land exactly on its target and move on
+		this->dLevel = dTarget;
+
+		if (i > 0)
+			pGain[i - 1] = dTarget;
 
-				return 1.0 - k;
-			}
+		switch (nStage)
+		{
+		case ENV_DELAY:
+			Enter(ENV_ATTACK);
+			break;
+		case ENV_ATTACK:
+			Enter(parameters.dHold > 0.0 ? ENV_HOLD : ENV_DECAY);
+			break;
+		case ENV_HOLD:
+			Enter(ENV_DECAY);
+			break;
+		case ENV_DECAY:
+			if (parameters.bLoop)
+				Enter(ENV_ATTACK);
+			else if (parameters.dSustain > 0.0)
+				Enter(ENV_SUSTAIN);
 			else
-				bActive = false;
+				Enter(ENV_IDLE); //nothing left to sustain, the note is over
+			break;
+		default:
+			Enter(ENV_IDLE);
+			break;
 		}
-		
-	}		
-
-	return 0.0;
+	}
 }
 
 void Envelope::StartEnvelope()
 {
-	dTriggerStartTime = std::clock();
-	bActive = true;
-	bReleased = false;
+	bGate.store(true, std::memory_order_relaxed);
+	nTriggers.fetch_add(1, std::memory_order_release);
 }
 
 void Envelope::StopEnvelope()
 {
-	dTriggerEndAmplitude = GetAmplitude();
-
-	dTriggerEndTime = std::clock();
-	bReleased = true;
+	bGate.store(false, std::memory_order_relaxed);
 }
@@ -1,45 +1,85 @@
 #pragma once
 
-#include <ctime>
+#include <atomic>
+#include <cstdint>
+
+//envelope stages
+#define ENV_IDLE 0
+#define ENV_DELAY 1
+#define ENV_ATTACK 2
+#define ENV_HOLD 3
+#define ENV_DECAY 4
+#define ENV_SUSTAIN 5
+#define ENV_RELEASE 6
+
+//overshoot of the exponential segments relative to their span, smaller is more curved
+#define ENV_ATTACK_RATIO 0.3
+#define ENV_DECAY_RATIO 0.0001 //-80 dB at the end of the segment
 
 struct EnvelopeParameters
 {
+	double dDelay = 0.0;
 	double dAttack = 1.0;
+	double dHold = 0.0;
 	double dDecay = 10.0;
 	double dSustain = 0.8;
 	double dRelease = 100.0;
+	bool bExponential = true; //exponential segments instead of straight lines
+	bool bLoop = false; //repeat attack, hold and decay while the gate is held
 };
 
+//DAHDSR envelope. Every segment is a recursion level = level * mul + add with coefficients computed once
+//when the segment starts, so it lasts exactly its time from any start level. Times are in milliseconds.
 class Envelope
 {
 public:
 	Envelope();
 	~Envelope();
 
+	void SetDelay(double dDelay);
 	void SetAttack(double dAttack);
+	void SetHold(double dHold);
 	void SetDecay(double dDecay);
 	void SetSustain(double dSustain);
 	void SetRelease(double dRelease);
+	void SetExponential(bool bExponential);
+	void SetLoop(bool bLoop);
+	void SetSampleRate(unsigned int nSampleRate);
+	void SetParameters(const EnvelopeParameters &p);
 
+	double GetDelay();
 	double GetAttack();
+	double GetHold();
 	double GetDecay();
 	double GetSustain();
 	double GetRelease();
+	bool GetExponential();
+	bool GetLoop();
+	EnvelopeParameters GetParameters();
 
-	double GetAmplitude();
-	void StartEnvelope();
+	double GetAmplitude(); //level of the last processed frame
+	bool IsActive();
+	void Process(double *pGain, unsigned int nFrames); //fills pGain with the next nFrames levels
+	void StartEnvelope(); //gate on/off, safe to call from the GUI thread, applied by the next Process
 	void StopEnvelope();
 
-
-
 private:
-	std::clock_t dTriggerStartTime;
-	std::clock_t dTriggerEndTime;
-
 	EnvelopeParameters parameters;
+	unsigned int nSampleRate = 44100;
+
+	//gate requests from the GUI thread
+	std::atomic<bool> bGate;
+	std::atomic<uint32_t> nTriggers;
+	uint32_t nTriggersSeen = 0;
 
-	bool bActive = false;
-	bool bReleased= false;
+	int nStage = ENV_IDLE;
+	double dLevel = 0.0;
+	double dMul = 1.0; //coefficients of the current segment
+	double dAdd = 0.0;
+	double dTarget = 0.0; //level the segment ends on
+	unsigned int nRemaining = 0; //samples left in the segment
 
-	double dTriggerEndAmplitude = 0.0;
-};
\ No newline at end of file
+	void Enter(int nStage);
+	void Segment(double dTarget, double dTime, double dRatio);
+	void UpdateGate();
+};
@@ -0,0 +1,168 @@
+#include "FFT.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+FFT::FFT()
+{
+}
+
+FFT::~FFT()
+{
+}
+
+void FFT::SetSize(unsigned int nSize)
+{
+	unsigned int nPower = 4;
+
+	while (nPower < nSize)
+		nPower <<= 1;
+
+	this->nSize = nPower;
+	nHalf = nPower / 2;
+
+	nReverse.resize(nHalf);
+	dCos.resize(nHalf / 2);
+	dSin.resize(nHalf / 2);
+	dSplitCos.resize(nHalf);
+	dSplitSin.resize(nHalf);
+	dWorkRe.resize(nHalf);
+	dWorkIm.resize(nHalf);
+
+	unsigned int nBits = 0;
+
+	while ((1u << nBits) < nHalf)
+		nBits++;
+
+	for (unsigned int i = 0; i < nHalf; i++)
+	{
+		unsigned int r = 0;
+
+		for (unsigned int b = 0; b < nBits; b++)
+			r |= ((i >> b) & 1) << (nBits - 1 - b);
+
+		nReverse[i] = r;
+	}
+
+	for (unsigned int k = 0; k < nHalf / 2; k++)
+	{
+		dCos[k] = cos(PI_R * k / nHalf);
+		dSin[k] = sin(PI_R * k / nHalf);
+	}
+
+	for (unsigned int k = 0; k < nHalf; k++)
+	{
+		dSplitCos[k] = cos(PI_R * k / this->nSize);
+		dSplitSin[k] = sin(PI_R * k / this->nSize);
+	}
+}
+
+unsigned int FFT::GetSize()
+{
+	return nSize;
+}
+
+//in place complex transform of nHalf points, the input has to be in bit reversed order
+void FFT::Transform(double *pRe, double *pIm, bool bInverse)
+{
+	double dSign = bInverse ? 1.0 : -1.0;
+
+	for (unsigned int nLength = 2; nLength <= nHalf; nLength <<= 1)
+	{
+		unsigned int nButterflies = nLength / 2;
+		unsigned int nStep = nHalf / nLength;
+
+		for (unsigned int i = 0; i < nHalf; i += nLength)
+		{
+			for (unsigned int j = 0; j < nButterflies; j++)
+			{
+				double wRe = dCos[j * nStep];
+				double wIm = dSign * dSin[j * nStep];
+
+				unsigned int a = i + j;
+				unsigned int b = a + nButterflies;
+
+				double tRe = pRe[b] * wRe - pIm[b] * wIm;
+				double tIm = pRe[b] * wIm + pIm[b] * wRe;
+
+				pRe[b] = pRe[a] - tRe;
+				pIm[b] = pIm[a] - tIm;
+				pRe[a] += tRe;
+				pIm[a] += tIm;
+			}
+		}
+	}
+}
+
+//the even samples go in as real parts and the odd ones as imaginary parts,
+//the spectra of both halves are then separated and combined into the full spectrum
+void FFT::Forward(const double *pIn, double *pRe, double *pIm)
+{
+	double *zRe = dWorkRe.data();
+	double *zIm = dWorkIm.data();
+
+	for (unsigned int n = 0; n < nHalf; n++)
+	{
+		zRe[nReverse[n]] = pIn[2 * n];
+		zIm[nReverse[n]] = pIn[2 * n + 1];
+	}
+
+	Transform(zRe, zIm, false);
+
+	pRe[0] = zRe[0] + zIm[0];
+	pIm[0] = 0.0;
+	pRe[nHalf] = zRe[0] - zIm[0];
+	pIm[nHalf] = 0.0;
+
+	for (unsigned int k = 1; k < nHalf; k++)
+	{
+		unsigned int m = nHalf - k;
+
+		//even = (Z[k] + conj(Z[m])) / 2, odd = (Z[k] - conj(Z[m])) / 2i
+		double eRe = 0.5 * (zRe[k] + zRe[m]);
+		double eIm = 0.5 * (zIm[k] - zIm[m]);
+		double oRe = 0.5 * (zIm[k] + zIm[m]);
+		double oIm = -0.5 * (zRe[k] - zRe[m]);
+
+		//X[k] = even + e^(-2 PI i k / nSize) * odd
+		double wRe = dSplitCos[k];
+		double wIm = -dSplitSin[k];
+
+		pRe[k] = eRe + oRe * wRe - oIm * wIm;
+		pIm[k] = eIm + oRe * wIm + oIm * wRe;
+	}
+}
+
+void FFT::Inverse(const double *pRe, const double *pIm, double *pOut)
+{
+	double *zRe = dWorkRe.data();
+	double *zIm = dWorkIm.data();
+	double dScale = 1.0 / nHalf;
+
+	for (unsigned int k = 0; k < nHalf; k++)
+	{
+		unsigned int m = nHalf - k;
+
+		//even = (X[k] + conj(X[m])) / 2, odd = (X[k] - conj(X[m])) * e^(2 PI i k / nSize) / 2
+		double eRe = 0.5 * (pRe[k] + pRe[m]);
+		double eIm = 0.5 * (pIm[k] - pIm[m]);
+		double dRe = 0.5 * (pRe[k] - pRe[m]);
+		double dIm = 0.5 * (pIm[k] + pIm[m]);
+		double wRe = dSplitCos[k];
+		double wIm = dSplitSin[k];
+		double oRe = dRe * wRe - dIm * wIm;
+		double oIm = dRe * wIm + dIm * wRe;
+
+		//Z[k] = even + i * odd
+		zRe[nReverse[k]] = eRe - oIm;
+		zIm[nReverse[k]] = eIm + oRe;
+	}
+
+	Transform(zRe, zIm, true);
+
+	for (unsigned int n = 0; n < nHalf; n++)
+	{
+		pOut[2 * n] = zRe[n] * dScale;
+		pOut[2 * n + 1] = zIm[n] * dScale;
+	}
+}
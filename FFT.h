@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+//Radix 2 FFT of real signals, computed as a complex transform of half the length.
+//Spectra are split into real and imaginary arrays of nSize / 2 + 1 bins from DC to nyquist.
+//The tables are set up by SetSize, the transforms themselves never allocate.
+//Forward and Inverse use the object's work arrays, so every thread needs its own FFT.
+class FFT
+{
+public:
+	FFT();
+	~FFT();
+
+	void SetSize(unsigned int nSize); //power of two from 4 on
+	unsigned int GetSize();
+
+	void Forward(const double *pIn, double *pRe, double *pIm);
+	void Inverse(const double *pRe, const double *pIm, double *pOut); //scaled so Inverse(Forward(x)) gives x back
+
+private:
+	unsigned int nSize = 0;
+	unsigned int nHalf = 0; //length of the complex transform
+
+	std::vector<unsigned int> nReverse; //bit reversed order of the complex transform
+	std::vector<double> dCos; //cos and sin of 2 * PI * k / nHalf
+	std::vector<double> dSin;
+	std::vector<double> dSplitCos; //cos and sin of 2 * PI * k / nSize, separate the two real halves
+	std::vector<double> dSplitSin;
+	std::vector<double> dWorkRe;
+	std::vector<double> dWorkIm;
+
+	void Transform(double *pRe, double *pIm, bool bInverse);
+};
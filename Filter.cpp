@@ -0,0 +1,197 @@
+#include "Filter.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+#define TAN_TABLE_SIZE ((int)((FILTER_TAN_HIGH - FILTER_TAN_LOW) * FILTER_TAN_STEPS) + 2)
+
+static double dTanTable[TAN_TABLE_SIZE + 1];
+
+static bool BuildTanTable()
+{
+	for (int i = 0; i <= TAN_TABLE_SIZE; i++)
+		dTanTable[i] = tan(PI * exp2(FILTER_TAN_LOW + i / (double)FILTER_TAN_STEPS));
+
+	return true;
+}
+
+static bool bTanTable = BuildTanTable();
+
+double FilterPitch(double dFrequency, unsigned int nSampleRate)
+{
+	return log2(dFrequency / nSampleRate);
+}
+
+//high = input - k * band - low, the other responses follow from it
+void SVFMix(int nMode, double k, double &m0, double &m1, double &m2)
+{
+	switch (nMode)
+	{
+	case SVF_HIGHPASS:
+		m0 = 1.0;
+		m1 = -k;
+		m2 = -1.0;
+		break;
+	case SVF_BANDPASS:
+		m0 = 0.0;
+		m1 = k;
+		m2 = 0.0;
+		break;
+	case SVF_NOTCH: //low + high
+		m0 = 1.0;
+		m1 = -k;
+		m2 = 0.0;
+		break;
+	case SVF_PEAK: //low - high
+		m0 = -1.0;
+		m1 = k;
+		m2 = 2.0;
+		break;
+	default:
+		m0 = 0.0;
+		m1 = 0.0;
+		m2 = 1.0;
+		break;
+	}
+}
+
+const double *FilterTanTable()
+{
+	return dTanTable;
+}
+
+BiQuad::BiQuad()
+{
+	b0 = b1 = b2 = a1 = a2 = 0.0;
+	db0 = db1 = db2 = da1 = da2 = 0.0;
+}
+
+BiQuad::~BiQuad()
+{
+}
+
+void BiQuad::SetType(int nType)
+{
+	if (this->nType != nType)
+	{
+		this->nType = nType;
+		bChanged = true;
+	}
+}
+
+void BiQuad::SetFrequency(double dFrequency)
+{
+	if (this->dFrequency != dFrequency)
+	{
+		this->dFrequency = dFrequency;
+		bChanged = true;
+	}
+}
+
+void BiQuad::SetQ(double dQ)
+{
+	if (this->dQ != dQ)
+	{
+		this->dQ = dQ;
+		bChanged = true;
+	}
+}
+
+void BiQuad::SetSampleRate(unsigned int nSampleRate)
+{
+	if (this->nSampleRate != nSampleRate)
+	{
+		this->nSampleRate = nSampleRate;
+		bChanged = true;
+	}
+}
+
+void BiQuad::SetControlRate(unsigned int nSamples)
+{
+	nControlRate = nSamples > 0 ? nSamples : 1;
+}
+
+void BiQuad::Reset()
+{
+	w1 = w2 = 0.0;
+	bGlide = false;
+	bChanged = true;
+}
+
+void BiQuad::Update()
+{
+	double w0 = PI_R * dFrequency / nSampleRate;
+	double dCos = cos(w0);
+	double alpha = sin(w0) / (2 * dQ);
+	double a0 = 1 + alpha;
+
+	if (nType == BIQUAD_HIGHPASS)
+	{
+		dTarget[0] = (1 + dCos) / 2.0 / a0;
+		dTarget[1] = -(1 + dCos) / a0;
+	}
+	else
+	{
+		dTarget[0] = (1 - dCos) / 2.0 / a0;
+		dTarget[1] = (1 - dCos) / a0;
+	}
+
+	dTarget[2] = dTarget[0];
+	dTarget[3] = -2 * dCos / a0;
+	dTarget[4] = (1 - alpha) / a0;
+
+	bChanged = false;
+
+	if (!bGlide || nControlRate <= 1)
+	{
+		b0 = dTarget[0];
+		b1 = dTarget[1];
+		b2 = dTarget[2];
+		a1 = dTarget[3];
+		a2 = dTarget[4];
+		nRamp = 0;
+		bGlide = true;
+	}
+	else
+	{
+		db0 = (dTarget[0] - b0) / nControlRate;
+		db1 = (dTarget[1] - b1) / nControlRate;
+		db2 = (dTarget[2] - b2) / nControlRate;
+		da1 = (dTarget[3] - a1) / nControlRate;
+		da2 = (dTarget[4] - a2) / nControlRate;
+		nRamp = nControlRate;
+	}
+}
+
+double BiQuad::Process(double dInput)
+{
+	if (nRamp > 0)
+	{
+		if (--nRamp == 0)
+		{
+			b0 = dTarget[0];
+			b1 = dTarget[1];
+			b2 = dTarget[2];
+			a1 = dTarget[3];
+			a2 = dTarget[4];
+		}
+		else
+		{
+			b0 += db0;
+			b1 += db1;
+			b2 += db2;
+			a1 += da1;
+			a2 += da2;
+		}
+	}
+	else if (bChanged)
+		Update();
+
+	double w = dInput - a1 * w1 - a2 * w2;
+	double dOut = b0 * w + b1 * w1 + b2 * w2;
+
+	w2 = w1;
+	w1 = w;
+
+	return dOut;
+}
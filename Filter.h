@@ -0,0 +1,67 @@
+#pragma once
+
+#define FILTER_CONTROL_RATE 32 //samples between coefficient updates while the cutoff is modulated
+
+#define FILTER_STAGES 4 //cascaded 2 pole stages, up to -24 dB/Oct
+#define FILTER_CHANNELS 4
+
+//cutoff pitch table, pitch is log2(frequency / sample rate)
+#define FILTER_TAN_STEPS 64 //entries per octave
+#define FILTER_TAN_LOW -16.0 //below 1 Hz at 44.1 kHz
+#define FILTER_TAN_HIGH -1.0291463456595165 //log2(0.49), the highest cutoff the table covers
+
+//state variable filter responses, all mixed from the same computation
+#define SVF_LOWPASS 0
+#define SVF_HIGHPASS 1
+#define SVF_BANDPASS 2 //unity gain at the cutoff
+#define SVF_NOTCH 3
+#define SVF_PEAK 4
+
+//biquad responses
+#define BIQUAD_LOWPASS 0
+#define BIQUAD_HIGHPASS 1
+
+double FilterPitch(double dFrequency, unsigned int nSampleRate); //log2(dFrequency / nSampleRate)
+void SVFMix(int nMode, double k, double &m0, double &m1, double &m2); //response = m0 * input + m1 * band + m2 * low, k = 1 / Q
+const double *FilterTanTable(); //tan(PI * 2^pitch), entry i is at pitch FILTER_TAN_LOW + i / FILTER_TAN_STEPS
+
+//Filters keep their coefficients and only recompute them when frequency, Q or sample rate change.
+//Changes are picked up at most once per control period, the coefficients glide to the new values
+//over that period so a modulated cutoff costs one coefficient update per period instead of per sample.
+
+//RBJ biquad, direct form II
+class BiQuad
+{
+public:
+	BiQuad();
+	~BiQuad();
+
+	void SetType(int nType);
+	void SetFrequency(double dFrequency);
+	void SetQ(double dQ);
+	void SetSampleRate(unsigned int nSampleRate);
+	void SetControlRate(unsigned int nSamples);
+	void Reset(); //clears the state, the next coefficients apply without a glide
+
+	double Process(double dInput);
+
+private:
+	int nType = BIQUAD_LOWPASS;
+	double dFrequency = 1000.0;
+	double dQ = 0.707;
+	unsigned int nSampleRate = 44100;
+	unsigned int nControlRate = FILTER_CONTROL_RATE;
+
+	bool bChanged = true;
+	bool bGlide = false; //false until the first coefficients are set
+	unsigned int nRamp = 0;
+
+	double b0, b1, b2, a1, a2; //normalized by a0
+	double db0, db1, db2, da1, da2; //per sample glide
+	double dTarget[5];
+
+	double w1 = 0.0;
+	double w2 = 0.0;
+
+	void Update();
+};
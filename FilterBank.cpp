@@ -0,0 +1,412 @@
+#include "FilterBank.h"
+#include "SIMD.h"
+
+//tanh from its 3/3 pade approximant, exactly +-1 from +-3 on, one division
+template <class V>
+static typename V::T Saturate(typename V::T x)
+{
+	typedef typename V::T T;
+
+	x = V::Min(V::Max(x, V::Set(-3.0)), V::Set(3.0));
+
+	T x2 = V::Mul(x, x);
+
+	return V::Div(V::Mul(x, V::Add(V::Set(27.0), x2)), V::Add(V::Set(27.0), V::Mul(V::Set(9.0), x2)));
+}
+
+//g = tan(PI * f / fs) of every lane from its pitch, interpolated between table entries 1/64 octave apart,
+//the cutoff this g stands for is off by less than 2 cents
+template <class V>
+static typename V::T Warp(typename V::T p)
+{
+	typedef typename V::T T;
+
+	p = V::Min(V::Max(p, V::Set(FILTER_TAN_LOW)), V::Set(FILTER_TAN_HIGH));
+	T idx = V::Mul(V::Sub(p, V::Set(FILTER_TAN_LOW)), V::Set(FILTER_TAN_STEPS));
+	T n = V::Floor(idx);
+	T g0, g1;
+
+	V::Gather(FilterTanTable(), n, g0, g1);
+
+	return V::Add(g0, V::Mul(V::Sub(idx, n), V::Sub(g1, g0)));
+}
+
+//trapezoidal SVF coefficients from g and k = 1 / Q
+template <class V>
+static void SVFCoefficients(typename V::T g, typename V::T k, typename V::T &a1, typename V::T &a2, typename V::T &a3)
+{
+	a1 = V::Div(V::Set(1.0), V::Add(V::Set(1.0), V::Mul(g, V::Add(g, k))));
+	a2 = V::Mul(g, a1);
+	a3 = V::Mul(g, a2);
+}
+
+FilterBank::FilterBank()
+{
+	nVoices = 0;
+	nStages = 2;
+	nMode = SVF_LOWPASS;
+	nType = FILTER_SVF;
+	nOversampling = 2;
+	dQ = 0.707;
+	dCoeffQ = dQ;
+	nControlRate = FILTER_CONTROL_RATE;
+	nControl = 0;
+	bUpdate = false;
+
+	for (int i = 0; i < FILTER_BANK_VOICES; i++)
+	{
+		dPitch[i] = FILTER_TAN_HIGH;
+
+		for (int c = 0; c < FILTER_CHANNELS; c++)
+			dInput[c][i] = 0.0;
+
+		ResetVoice(i);
+	}
+}
+
+FilterBank::~FilterBank()
+{
+}
+
+void FilterBank::SetVoiceCount(int nVoices)
+{
+	if (nVoices < 0)
+		nVoices = 0;
+	else if (nVoices > FILTER_BANK_VOICES)
+		nVoices = FILTER_BANK_VOICES;
+
+	this->nVoices = nVoices;
+}
+
+int FilterBank::GetVoiceCount()
+{
+	return nVoices;
+}
+
+void FilterBank::SetStages(int nStages)
+{
+	if (nStages < 1)
+		nStages = 1;
+	else if (nStages > FILTER_STAGES)
+		nStages = FILTER_STAGES;
+
+	//stages that were bypassed start from silence
+	for (int c = 0; c < FILTER_CHANNELS; c++)
+	{
+		for (int s = this->nStages; s < nStages; s++)
+		{
+			for (int i = 0; i < FILTER_BANK_VOICES; i++)
+				ic1eq[c][s][i] = ic2eq[c][s][i] = 0.0;
+		}
+	}
+
+	this->nStages = nStages;
+}
+
+void FilterBank::SetMode(int nMode)
+{
+	this->nMode = nMode;
+}
+
+void FilterBank::SetType(int nType)
+{
+	this->nType = nType;
+}
+
+void FilterBank::SetOversampling(int nFactor)
+{
+	nOversampling = nFactor >= 4 ? 4 : (nFactor >= 2 ? 2 : 1);
+}
+
+void FilterBank::SetQ(double dQ)
+{
+	this->dQ = dQ;
+}
+
+void FilterBank::SetControlRate(unsigned int nFrames)
+{
+	nControlRate = nFrames > 0 ? nFrames : 1;
+	nControl = 0;
+}
+
+void FilterBank::ResetVoice(int nVoice)
+{
+	if (nVoice < 0 || nVoice >= FILTER_BANK_VOICES)
+		return;
+
+	bSnap[nVoice] = true;
+	bSnapPending = true;
+
+	for (int c = 0; c < FILTER_CHANNELS; c++)
+	{
+		for (int s = 0; s < FILTER_STAGES; s++)
+			ic1eq[c][s][nVoice] = ic2eq[c][s][nVoice] = 0.0;
+
+		for (int s = 0; s < 4; s++)
+			dLadder[c][s][nVoice] = dLadderSat[c][s][nVoice] = 0.0;
+
+		oversampler[c].Reset(nVoice);
+	}
+}
+
+//coefficients of restarted voices straight from their pitch, every voice when Q changed
+void FilterBank::Snap()
+{
+	bool bAll = dQ != dCoeffQ;
+
+	if (!bSnapPending && !bAll)
+		return;
+
+	dCoeffQ = dQ;
+	bSnapPending = false;
+
+	for (int i = 0; i < FILTER_BANK_VOICES; i++)
+	{
+		if (!bSnap[i] && !bAll)
+			continue;
+
+		double a[3];
+
+		SVFCoefficients<VecScalar>(Warp<VecScalar>(dPitch[i]), 1.0 / dQ, a[0], a[1], a[2]);
+
+		for (int j = 0; j < 3; j++)
+		{
+			dCoeff[j][i] = dCoeffTarget[j][i] = a[j];
+			dCoeffStep[j][i] = 0.0;
+		}
+
+		dCoeffPitch[i] = dPitch[i];
+		bSnap[i] = false;
+	}
+}
+
+double *FilterBank::GetPitches()
+{
+	return dPitch;
+}
+
+double *FilterBank::GetInputs(unsigned int nChannel)
+{
+	return dInput[nChannel];
+}
+
+//trapezoidal SVF stages in series, g is interpolated from the shared tan table in every lane
+//at the start of a control period where one of the vector's pitches moved
+template <class V>
+void FilterBank::Render(int nFirst, int nLast, unsigned int nChannels, double *pFrame)
+{
+	typedef typename V::T T;
+
+	double m[3];
+	SVFMix(nMode, 1.0 / dQ, m[0], m[1], m[2]);
+
+	T k = V::Set(1.0 / dQ);
+	T rate = V::Set(1.0 / nControlRate);
+	T m0 = V::Set(m[0]);
+	T m1 = V::Set(m[1]);
+	T m2 = V::Set(m[2]);
+	T sum[FILTER_CHANNELS];
+
+	for (unsigned int c = 0; c < nChannels; c++)
+		sum[c] = V::Set(0.0);
+
+	for (int i = nFirst; i < nLast; i += V::N)
+	{
+		if (bUpdate)
+		{
+			bool bMoved = false;
+
+			for (int l = 0; l < V::N; l++)
+				bMoved |= dPitch[i + l] != dCoeffPitch[i + l];
+
+			if (bMoved)
+			{
+				T p = V::Load(dPitch + i);
+				T t[3];
+
+				SVFCoefficients<V>(Warp<V>(p), k, t[0], t[1], t[2]);
+
+				for (int j = 0; j < 3; j++)
+					V::Store(dCoeffTarget[j] + i, t[j]);
+
+				V::Store(dCoeffPitch + i, p);
+			}
+
+			//the steps of the last period always run out, a glide never overshoots its target
+			for (int j = 0; j < 3; j++)
+				V::Store(dCoeffStep[j] + i, V::Mul(V::Sub(V::Load(dCoeffTarget[j] + i), V::Load(dCoeff[j] + i)), rate));
+		}
+
+		T a1 = V::Add(V::Load(dCoeff[0] + i), V::Load(dCoeffStep[0] + i));
+		T a2 = V::Add(V::Load(dCoeff[1] + i), V::Load(dCoeffStep[1] + i));
+		T a3 = V::Add(V::Load(dCoeff[2] + i), V::Load(dCoeffStep[2] + i));
+
+		V::Store(dCoeff[0] + i, a1);
+		V::Store(dCoeff[1] + i, a2);
+		V::Store(dCoeff[2] + i, a3);
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			T v0 = V::Load(dInput[c] + i);
+
+			for (int s = 0; s < nStages; s++)
+			{
+				T s1 = V::Load(ic1eq[c][s] + i);
+				T s2 = V::Load(ic2eq[c][s] + i);
+
+				T v3 = V::Sub(v0, s2);
+				T v1 = V::Add(V::Mul(a1, s1), V::Mul(a2, v3));
+				T v2 = V::Add(V::Add(s2, V::Mul(a2, s1)), V::Mul(a3, v3));
+
+				V::Store(ic1eq[c][s] + i, V::Sub(V::Add(v1, v1), s1));
+				V::Store(ic2eq[c][s] + i, V::Sub(V::Add(v2, v2), s2));
+
+				v0 = V::Add(V::Add(V::Mul(m0, v0), V::Mul(m1, v1)), V::Mul(m2, v2));
+			}
+
+			sum[c] = V::Add(sum[c], v0);
+		}
+	}
+
+	for (unsigned int c = 0; c < nChannels; c++)
+		pFrame[c] += V::Sum(sum[c]);
+
+	V::End();
+}
+
+//one pole lowpasses in series with tanh saturation in the stages and in the resonance feedback,
+//every frame is raised to nFactor samples, filtered at that rate and brought back down
+template <class V, int nFactor>
+void FilterBank::RenderLadder(int nFirst, int nLast, unsigned int nChannels, double *pFrame)
+{
+	typedef typename V::T T;
+
+	double dFeedback = LADDER_FEEDBACK * (1.0 - 0.5 / dQ); //Q 0.5 has no resonance, the ladder rings from 4 on
+
+	if (dFeedback < 0.0)
+		dFeedback = 0.0;
+	else if (dFeedback > LADDER_FEEDBACK)
+		dFeedback = LADDER_FEEDBACK;
+
+	T k = V::Set(dFeedback);
+	T drive = V::Set(LADDER_DRIVE);
+	T sum[FILTER_CHANNELS];
+
+	for (unsigned int c = 0; c < nChannels; c++)
+		sum[c] = V::Set(0.0);
+
+	for (int i = nFirst; i < nLast; i += V::N)
+	{
+		//cutoff relative to the raised rate
+		T g = Warp<V>(V::Sub(V::Load(dPitch + i), V::Set(nFactor == 4 ? 2.0 : nFactor == 2 ? 1.0 : 0.0)));
+		T G = V::Div(g, V::Add(V::Set(1.0), g));
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			T y[4], t[4], x[nFactor];
+
+			for (int s = 0; s < 4; s++)
+			{
+				y[s] = V::Load(dLadder[c][s] + i);
+				t[s] = V::Load(dLadderSat[c][s] + i);
+			}
+
+			oversampler[c].Up<V, nFactor>(i, V::Mul(V::Load(dInput[c] + i), drive), x);
+
+			for (int o = 0; o < nFactor; o++)
+			{
+				T u = Saturate<V>(V::Sub(x[o], V::Mul(k, y[3])));
+
+				y[0] = V::Add(y[0], V::Mul(G, V::Sub(u, t[0])));
+				t[0] = Saturate<V>(y[0]);
+				y[1] = V::Add(y[1], V::Mul(G, V::Sub(t[0], t[1])));
+				t[1] = Saturate<V>(y[1]);
+				y[2] = V::Add(y[2], V::Mul(G, V::Sub(t[1], t[2])));
+				t[2] = Saturate<V>(y[2]);
+				y[3] = V::Add(y[3], V::Mul(G, V::Sub(t[2], t[3])));
+				t[3] = Saturate<V>(y[3]);
+
+				x[o] = y[3];
+			}
+
+			for (int s = 0; s < 4; s++)
+			{
+				V::Store(dLadder[c][s] + i, y[s]);
+				V::Store(dLadderSat[c][s] + i, t[s]);
+			}
+
+			sum[c] = V::Add(sum[c], oversampler[c].Down<V, nFactor>(i, x));
+		}
+	}
+
+	for (unsigned int c = 0; c < nChannels; c++)
+		pFrame[c] += V::Sum(sum[c]) / LADDER_DRIVE;
+
+	V::End();
+}
+
+struct filterKernels
+{
+	static const FilterBank::Kernel kernels[SIMD_AVX512 + 1];
+	static const FilterBank::Kernel ladderKernels[SIMD_AVX512 + 1][3]; //2^n times oversampled
+};
+
+const FilterBank::Kernel filterKernels::kernels[SIMD_AVX512 + 1] =
+{
+	&FilterBank::Render<VecScalar>,
+	&FilterBank::Render<VecSSE2>,
+	&FilterBank::Render<VecAVX2>,
+	&FilterBank::Render<VecAVX512>,
+};
+
+const FilterBank::Kernel filterKernels::ladderKernels[SIMD_AVX512 + 1][3] =
+{
+	{ &FilterBank::RenderLadder<VecScalar, 1>, &FilterBank::RenderLadder<VecScalar, 2>, &FilterBank::RenderLadder<VecScalar, 4> },
+	{ &FilterBank::RenderLadder<VecSSE2, 1>, &FilterBank::RenderLadder<VecSSE2, 2>, &FilterBank::RenderLadder<VecSSE2, 4> },
+	{ &FilterBank::RenderLadder<VecAVX2, 1>, &FilterBank::RenderLadder<VecAVX2, 2>, &FilterBank::RenderLadder<VecAVX2, 4> },
+	{ &FilterBank::RenderLadder<VecAVX512, 1>, &FilterBank::RenderLadder<VecAVX512, 2>, &FilterBank::RenderLadder<VecAVX512, 4> },
+};
+
+void FilterBank::Process(double *pFrame, unsigned int nChannels)
+{
+	if (nChannels > FILTER_CHANNELS)
+		nChannels = FILTER_CHANNELS;
+
+	for (unsigned int c = 0; c < nChannels; c++)
+		pFrame[c] = 0.0;
+
+	int nSet = SIMDInstructionSet();
+	int nRate = nOversampling == 4 ? 2 : nOversampling - 1;
+	Kernel pVectorKernel = filterKernels::kernels[nSet];
+	Kernel pScalarKernel = filterKernels::kernels[SIMD_SCALAR];
+
+	if (nType == FILTER_LADDER)
+	{
+		pVectorKernel = filterKernels::ladderKernels[nSet][nRate];
+		pScalarKernel = filterKernels::ladderKernels[SIMD_SCALAR][nRate];
+	}
+	else
+	{
+		Snap();
+
+		bUpdate = nControl == 0;
+
+		if (++nControl >= nControlRate)
+			nControl = 0;
+	}
+
+	//full vectors first, the remaining voices go through the scalar kernel
+	int nVector = nVoices - nVoices % SIMDWidth(nSet);
+
+	if (nVector > 0)
+		(this->*pVectorKernel)(0, nVector, nChannels, pFrame);
+
+	if (nVector < nVoices)
+		(this->*pScalarKernel)(nVector, nVoices, nChannels, pFrame);
+
+	if (nType == FILTER_LADDER)
+	{
+		for (unsigned int c = 0; c < nChannels; c++)
+			oversampler[c].Next();
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Filter.h"
+#include "Oversampler.h"
+
+#define FILTER_BANK_VOICES OVERSAMPLE_LANES
+
+//filter topologies
+#define FILTER_SVF 0
+#define FILTER_LADDER 1 //4 pole transistor ladder, lowpass only
+
+#define LADDER_DRIVE 4.0 //input gain into the saturating stages, undone at the output
+#define LADDER_FEEDBACK 4.0 //resonance feedback where the ladder self oscillates
+
+//Multimode SVF cascades or saturating ladders of many voices stored as structure of arrays, one voice per SIMD lane.
+//The SVF coefficients of a lane are recomputed from its cutoff pitch only when the pitch moved, checked once per
+//control period, and glide to the new values over the period. A voice that restarts or a new Q takes them at once.
+//Each channel runs through all stages before the voices are summed.
+//The ladder runs at 2 or 4 times the sample rate so its saturation does not alias.
+class FilterBank
+{
+public:
+	FilterBank();
+	~FilterBank();
+
+	void SetVoiceCount(int nVoices);
+	int GetVoiceCount();
+	void SetStages(int nStages);
+	void SetMode(int nMode); //one of the SVF responses, shared by every voice
+	void SetType(int nType);
+	void SetOversampling(int nFactor); //1, 2 or 4, only used by the ladder
+	void SetQ(double dQ);
+	void SetControlRate(unsigned int nFrames);
+	void ResetVoice(int nVoice);
+
+	double *GetPitches(); //cutoff of every voice for the next frame, log2(cutoff / sample rate)
+	double *GetInputs(unsigned int nChannel); //input of every voice for the next frame
+
+	void Process(double *pFrame, unsigned int nChannels); //filters every voice, pFrame gets the sum of all voices per channel
+
+	typedef void (FilterBank::*Kernel)(int nFirst, int nLast, unsigned int nChannels, double *pFrame);
+
+private:
+	friend struct filterKernels;
+
+	double dPitch[FILTER_BANK_VOICES];
+	double dInput[FILTER_CHANNELS][FILTER_BANK_VOICES];
+	double ic1eq[FILTER_CHANNELS][FILTER_STAGES][FILTER_BANK_VOICES];
+	double ic2eq[FILTER_CHANNELS][FILTER_STAGES][FILTER_BANK_VOICES];
+	double dLadder[FILTER_CHANNELS][4][FILTER_BANK_VOICES]; //ladder stage outputs
+	double dLadderSat[FILTER_CHANNELS][4][FILTER_BANK_VOICES]; //saturated stage outputs
+	Oversampler oversampler[FILTER_CHANNELS];
+
+	//SVF a1, a2, a3 of every lane
+	double dCoeff[3][FILTER_BANK_VOICES];
+	double dCoeffStep[3][FILTER_BANK_VOICES]; //per frame glide
+	double dCoeffTarget[3][FILTER_BANK_VOICES];
+	double dCoeffPitch[FILTER_BANK_VOICES]; //pitch the targets were computed for
+	bool bSnap[FILTER_BANK_VOICES]; //take the next coefficients without a glide
+	bool bSnapPending;
+	double dCoeffQ;
+	unsigned int nControlRate;
+	unsigned int nControl; //frames into the control period
+	bool bUpdate; //the current frame starts a control period
+
+	int nVoices;
+	int nStages;
+	int nMode;
+	int nType;
+	int nOversampling;
+	double dQ;
+
+	void Snap();
+
+	template <class V>
+	void Render(int nFirst, int nLast, unsigned int nChannels, double *pFrame);
+	template <class V, int nFactor>
+	void RenderLadder(int nFirst, int nLast, unsigned int nChannels, double *pFrame);
+};
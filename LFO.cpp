@@ -0,0 +1,64 @@
+#include "LFO.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+ControlLFO::ControlLFO()
+{
+	for (int i = 0; i < LFO_LANES; i++)
+		dOffset[i] = 0.0;
+}
+
+ControlLFO::~ControlLFO()
+{
+}
+
+void ControlLFO::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+}
+
+void ControlLFO::SetRate(double dRate)
+{
+	this->dRate = dRate > 0.0 ? dRate : 0.0;
+}
+
+void ControlLFO::SetShape(int nShape)
+{
+	this->nShape = nShape;
+}
+
+void ControlLFO::SetOffset(int nLane, double dOffset)
+{
+	if (nLane >= 0 && nLane < LFO_LANES)
+		this->dOffset[nLane] = dOffset - floor(dOffset);
+}
+
+void ControlLFO::Reset()
+{
+	dPhase = 0.0;
+}
+
+double ControlLFO::Shape(double dPhase)
+{
+	dPhase -= floor(dPhase);
+
+	if (nShape == LFO_TRIANGLE)
+		return dPhase < 0.5 ? 4.0 * dPhase - 1.0 : 3.0 - 4.0 * dPhase;
+
+	return sin(PI_R * dPhase);
+}
+
+void ControlLFO::Next(unsigned int nFrames, double *pValue, double *pStep)
+{
+	double dAdvance = dRate * nFrames / nSampleRate;
+
+	for (int i = 0; i < LFO_LANES; i++)
+	{
+		pValue[i] = Shape(dPhase + dOffset[i]);
+		pStep[i] = nFrames > 0 ? (Shape(dPhase + dAdvance + dOffset[i]) - pValue[i]) / nFrames : 0.0;
+	}
+
+	dPhase += dAdvance;
+	dPhase -= floor(dPhase);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#define LFO_LANES 8
+
+//shapes
+#define LFO_SINE 0
+#define LFO_TRIANGLE 1
+
+//Low frequency oscillator for effects, evaluated at control rate for several lanes that share its rate.
+//Every lane runs at its own phase offset. Next() gives the value of every lane now
+//and the step per frame that ramps it to the value nFrames later, so per frame only an addition is left.
+class ControlLFO
+{
+public:
+	ControlLFO();
+	~ControlLFO();
+
+	void SetSampleRate(unsigned int nSampleRate);
+	void SetRate(double dRate); //Hz
+	void SetShape(int nShape);
+	void SetOffset(int nLane, double dOffset); //phase offset of the lane in cycles
+	void Reset();
+
+	void Next(unsigned int nFrames, double *pValue, double *pStep); //LFO_LANES values in -1..1 and steps
+
+private:
+	unsigned int nSampleRate = 44100;
+	double dRate = 1.0;
+	int nShape = LFO_SINE;
+	double dPhase = 0.0; //cycles
+	double dOffset[LFO_LANES];
+
+	double Shape(double dPhase);
+};
@@ -15,15 +15,28 @@
 #include "AudioInterface.h"
 #include "CfgWindow.h"
 #include "Oscillator.h"
+#include "OscillatorBank.h"
+#include "VoicePool.h"
+#include "Filter.h"
+#include "Distortion.h"
+#include "Dynamics.h"
+#include "ModEffects.h"
+#include "Delay.h"
+#include "Reverb.h"
+#include "Convolver.h"
 #include "Envelope.h"
-#include "MiscDSP.h"
 
 #define AVERAGE_SAMPLES 441
 
+#define SAMPLE_RATE 44100
+#define MAX_CHANNELS 4 //matches the channel volumes of oscParams
+
+static_assert(MAX_CHANNELS <= DYNAMICS_CHANNELS, "the limiter has to delay every output channel");
+
 #define C_SHARP_0 16.35
 
 #define APP_WIDTH 800
-#define APP_HEIGHT 600
+#define APP_HEIGHT 720
 
 #define INIT_MASTER_VOLUME 45 //45%
 #define OSC_VOLUME 0.125 //-18 dBFS
@@ -33,6 +46,10 @@
 #define FREQ_MIN 20.00
 #define FREQ_MAX 20000.00
 
+//cutoff modulation depths in octaves, the curves LinToLog used to map onto 0.001..1 and 0.000001..1
+#define FLTR_OSC_DEPTH 4.9828921423310435 //log2(1000) / 2 per unit of oscillator output
+#define FLTR_ENV_DEPTH 19.931568569324174 //log2(1000000) per unit of envelope level
+
 //matrix devices
 #define R_OSC1 0
 #define R_OSC2 1
@@ -74,23 +91,39 @@ struct SynthVars
 	unsigned int nMasterVolume = INIT_MASTER_VOLUME;
 
 	Oscillator osc[3];
-	Envelope ADSR;
+	Envelope ADSR; //envelope settings of the patch, every voice gets a copy
 
 	//route input to device mapping
 	const uint8_t deviceMap[6] = { 0, 0, 1, 1, 2, 2 };
 
 	double dNotes[12 * 9];
+	OscillatorBank noteBank[3]; //voice k of every bank plays voice k of the pool
+	double dOscFree[3] = { 0.0, 0.0, 0.0 }; //last free running output of every oscillator
 
-	vector<uint8_t> vNotesOn;
+	VoicePool voices;
 	uint16_t bKeyDown = 0;
-	uint8_t numKeysDown = 0;
+	uint8_t nKeyNote[16]; //note each key started, the octave may change while it is held
 	int8_t nOctave = 3;
 
 	bool octaveKeyDownState = false;
 
 	uint16_t nFilterCutoff = 22000;
+	uint16_t nPitchCutoff = 0; //cutoff dCutoffPitch was computed for, audio thread only
+	double dCutoffPitch = 0.0;
 	double dResonance = 1.0;
 	bool bFourthOrder = false;
+	int nLadder = 0; //oversampling factor of the ladder filter, 0 uses the SVF
+	int nFilterMode = SVF_LOWPASS;
+
+	FilterBank droneFilter; //drones have no voice and share one filter
+	BiQuad highPass[MAX_CHANNELS]; //removes everything below 30 Hz from the output
+	Distortion distortion;
+	ModEffects modEffects;
+	Delay delay;
+	Reverb reverb;
+	Convolver convolver;
+	Compressor compressor;
+	Limiter limiter; //last on the master, keeps the output under its ceiling
 
 	mutex muxRWOutput;
 	condition_variable cvIsOutputProcessed;
@@ -109,8 +142,8 @@ struct SynthVars
 
 bool routingMatrix[R_NUM_DEVS - 1][R_NUM_ROUTES];
 
-double synthFunction(double, byte);
-double SimpleLowPass(double currentSample);
+void synthFrame(double *pFrame, unsigned int nChannels, unsigned int nFrame);
+void synthBlock(double *pBlock, unsigned int nFrames, unsigned int nChannels, uint64_t nStartFrame);
 
 class MyFrame;
 
@@ -151,6 +184,7 @@ public:
 	wxCheckBox *checkDrone[3];
 	wxChoice *choiceOscRouting[3];
 	wxCheckBox *checkLFO[3];
+	wxChoice *choiceOscEngine[3];
 	wxRadioBox *octRadioBox[3];
 
 
@@ -171,6 +205,10 @@ private:
 	void OnOscDrone(wxCommandEvent& event);
 	void OnOscRouting(wxCommandEvent& event);
 	void OnOscLFO(wxCommandEvent& event);
+	void OnOscEngine(wxCommandEvent& event);
+	void OnOscPulseWidth(wxCommandEvent& event);
+	void OnOscSync(wxCommandEvent& event);
+	void OnOscFreeRun(wxCommandEvent& event);
 	void OnFreqFine(wxCommandEvent& event);
 	void OnOctaveSelect(wxCommandEvent& event);
 	void OnEnvelope(wxCommandEvent& event);
@@ -178,6 +216,19 @@ private:
 	void OnCutoff(wxCommandEvent& event);
 	void OnResonance(wxCommandEvent& event);
 	void OnFltrPoles(wxCommandEvent& event);
+	void OnFltrMode(wxCommandEvent& event);
+	void OnDelay(wxCommandEvent& event);
+	void OnDelaySync(wxCommandEvent& event);
+	void OnDelayPingPong(wxCommandEvent& event);
+	void OnReverb(wxCommandEvent& event);
+	void OnReverbMatrix(wxCommandEvent& event);
+	void OnConvolverMix(wxCommandEvent& event);
+	void OnConvolverLoad(wxCommandEvent& event);
+	void OnModEffects(wxCommandEvent& event);
+	void OnModEffectsType(wxCommandEvent& event);
+	void OnDistortion(wxCommandEvent& event);
+	void OnDistortionCurve(wxCommandEvent& event);
+	void OnDynamics(wxCommandEvent& event);
 
 	void OnPaint(wxPaintEvent &event);
 };
@@ -216,7 +267,43 @@ enum
 	ID_EnvRoute1,
 	ID_CutOff1,
 	ID_Resonance1,
-	ID_FltrPoles1
+	ID_FltrPoles1,
+	ID_FltrMode1,
+	ID_DlyTime1,
+	ID_DlyFeedback1,
+	ID_DlyTone1,
+	ID_DlyMix1,
+	ID_DlySync1,
+	ID_DlyPingPong1,
+	ID_RvbSize1,
+	ID_RvbDecay1,
+	ID_RvbDamping1,
+	ID_RvbMix1,
+	ID_RvbMatrix1,
+	ID_ConvMix1,
+	ID_ConvLoad1,
+	ID_ModRate1,
+	ID_ModDepth1,
+	ID_ModFeedback1,
+	ID_ModMix1,
+	ID_ModType1,
+	ID_DistDrive1,
+	ID_DistBits1,
+	ID_DistRate1,
+	ID_DistMix1,
+	ID_DistCurve1,
+	ID_CompThreshold1,
+	ID_CompRatio1,
+	ID_LimGain1,
+	ID_LimCeiling1,
+	ID_Engine1,
+	ID_Engine2,
+	ID_PulseWidth1,
+	ID_PulseWidth2,
+	ID_Sync1,
+	ID_Sync2,
+	ID_FreeRun1,
+	ID_FreeRun2
 };
 
 wxIMPLEMENT_APP(MyApp);
@@ -227,7 +314,7 @@ bool MyApp::OnInit()
 
 	vector<string> devices = AudioInterface::GetDevices();
 
-	synthVars.audioIF = new AudioInterface(devices[0], 44100, 2, 128, 32); //use first device in list
+	synthVars.audioIF = new AudioInterface(devices[0], SAMPLE_RATE, 2, 128, 32); //use first device in list
 
 	if (!synthVars.audioIF->GetActive())
 	{
@@ -235,7 +322,14 @@ bool MyApp::OnInit()
 		synthVars.audioIF->Destroy();
 	}
 
-	synthVars.audioIF->SetUserFunction(synthFunction);
+	synthVars.distortion.SetSampleRate(SAMPLE_RATE);
+	synthVars.modEffects.SetSampleRate(SAMPLE_RATE); //the delay lines have to exist before the first block
+	synthVars.delay.SetSampleRate(SAMPLE_RATE);
+	synthVars.reverb.SetSampleRate(SAMPLE_RATE);
+	synthVars.convolver.SetSampleRate(SAMPLE_RATE);
+	synthVars.compressor.SetSampleRate(SAMPLE_RATE);
+	synthVars.limiter.SetSampleRate(SAMPLE_RATE); //allocates the look-ahead
+	synthVars.audioIF->SetBlockFunction(synthBlock);
 
 	ZeroMemory(routingMatrix, R_NUM_ROUTES * (R_NUM_DEVS-1));
 	routingMatrix[R_OSC1][R_FLTR_I] = true;
@@ -251,6 +345,21 @@ bool MyApp::OnInit()
 	for (int i = 0; i < 12 * 9; i++)
 		synthVars.dNotes[i] = C_SHARP_0 * pow(2, i / 12.0);
 
+	for (int i = 0; i < 3; i++)
+		synthVars.osc[i].SetSampleRate(SAMPLE_RATE);
+
+	synthVars.ADSR.SetSampleRate(SAMPLE_RATE);
+	synthVars.voices.SetSampleRate(SAMPLE_RATE);
+	synthVars.voices.SetEnvelope(synthVars.ADSR.GetParameters());
+
+	for (int n = 0; n < MAX_CHANNELS; n++)
+	{
+		synthVars.highPass[n].SetType(BIQUAD_HIGHPASS);
+		synthVars.highPass[n].SetFrequency(30.0);
+		synthVars.highPass[n].SetQ(1.0);
+		synthVars.highPass[n].SetSampleRate(SAMPLE_RATE);
+	}
+
 	MyFrame *frame = new MyFrame();
 	frame->SetSize({ APP_WIDTH, APP_HEIGHT });
 	pFrame = frame;
@@ -271,20 +380,10 @@ int MyApp::FilterEvent(wxEvent & event)
 			{
 				pFrame->SetFocus();
 
-				if (synthVars.numKeysDown == 0)
-				{
-					synthVars.vNotesOn.clear();					
-				}	
-
-				synthVars.ADSR.StartEnvelope();
-
 				synthVars.bKeyDown |= (1<<i);
+				synthVars.nKeyNote[i] = synthVars.nOctave * 12 + i;
 
-				uint8_t nNote = synthVars.nOctave * 12 + i;
-				if (std::find(synthVars.vNotesOn.begin(), synthVars.vNotesOn.end(), nNote) == synthVars.vNotesOn.end())
-					synthVars.vNotesOn.push_back(nNote);
-
-				synthVars.numKeysDown++;
+				synthVars.voices.NoteOn(synthVars.nKeyNote[i]);
 
 				return false;
 			}
@@ -321,12 +420,11 @@ int MyApp::FilterEvent(wxEvent & event)
 			{
 				pFrame->SetFocus();
 
-				synthVars.bKeyDown ^= (1<<i);
-
-				synthVars.numKeysDown--;
-
-				if (synthVars.numKeysDown == 0)
-					synthVars.ADSR.StopEnvelope();
+				if (synthVars.bKeyDown & (1<<i))
+				{
+					synthVars.bKeyDown &= ~(1<<i);
+					synthVars.voices.NoteOff(synthVars.nKeyNote[i]);
+				}
 
 				return false;
 			}
@@ -404,7 +502,7 @@ MyFrame::MyFrame()
 	}
 
 	choiceOscWave[0] = new wxChoice(oscPanel[0], ID_Wave1, { 6, 6 }, wxDefaultSize);
-	choiceOscWave[0]->Append(vector<wxString>({ "Sine", "Square", "Saw", "Triangle", "Noise" }));
+	choiceOscWave[0]->Append(vector<wxString>({ "Sine", "Square", "Saw", "Triangle", "Noise", "Pink Noise", "Brown Noise" }));
 	choiceOscWave[0]->SetSelection(0);
 	Bind(wxEVT_CHOICE, &MyFrame::OnOscWave, this, ID_Wave1);
 
@@ -450,10 +548,24 @@ MyFrame::MyFrame()
 	choiceOscRouting[0]->SetSelection(7);
 	Bind(wxEVT_CHOICE, &MyFrame::OnOscRouting, this, ID_OscRouting1);
 
+	choiceOscEngine[0] = new wxChoice(oscPanel[0], ID_Engine1, { 120, 120 }, { 88, -1 });
+	choiceOscEngine[0]->Append(vector<wxString>({ "Naive", "Wavetable", "PolyBLEP" }));
+	choiceOscEngine[0]->SetSelection(synthVars.osc[0].GetEngine()); //choices are in OSC_ order
+	Bind(wxEVT_CHOICE, &MyFrame::OnOscEngine, this, ID_Engine1);
+
+	//fixed height so the slider fits between the pan label and the fine tune box
+	wxSlider *pwSlider = new wxSlider(oscPanel[0], ID_PulseWidth1, (int)(synthVars.osc[0].GetPulseWidth() * 100.0), 5, 95, { 114, 42 }, { 96, 18 });
+	Bind(wxEVT_SLIDER, &MyFrame::OnOscPulseWidth, this, ID_PulseWidth1);
+	wxStaticText *pwLabel = new wxStaticText(oscPanel[0], wxID_ANY, "Width", { 148, 60 });
+
+	wxCheckBox *checkFreeRun = new wxCheckBox(oscPanel[0], ID_FreeRun1, "Free", { 166, 100 });
+	checkFreeRun->SetValue(synthVars.osc[0].GetFreeRun());
+	Bind(wxEVT_CHECKBOX, &MyFrame::OnOscFreeRun, this, ID_FreeRun1);
+
 	//------
 
 	choiceOscWave[1] = new wxChoice(oscPanel[1], ID_Wave2, { 6, 6 }, wxDefaultSize);
-	choiceOscWave[1]->Append(vector<wxString>({ "Sine", "Square", "Saw", "Triangle", "Noise" }));
+	choiceOscWave[1]->Append(vector<wxString>({ "Sine", "Square", "Saw", "Triangle", "Noise", "Pink Noise", "Brown Noise" }));
 	choiceOscWave[1]->SetSelection(0);
 	Bind(wxEVT_CHOICE, &MyFrame::OnOscWave, this, ID_Wave2);
 
@@ -494,6 +606,24 @@ MyFrame::MyFrame()
 	octRadioBox[1]->SetSelection(synthVars.osc[1].GetOctaveMod() + 2);
 	Bind(wxEVT_RADIOBOX, &MyFrame::OnOctaveSelect, this, ID_OctSel2);
 
+	choiceOscEngine[1] = new wxChoice(oscPanel[1], ID_Engine2, { 120, 120 }, { 88, -1 });
+	choiceOscEngine[1]->Append(vector<wxString>({ "Naive", "Wavetable", "PolyBLEP" }));
+	choiceOscEngine[1]->SetSelection(synthVars.osc[1].GetEngine()); //choices are in OSC_ order
+	Bind(wxEVT_CHOICE, &MyFrame::OnOscEngine, this, ID_Engine2);
+
+	wxSlider *pwSlider2 = new wxSlider(oscPanel[1], ID_PulseWidth2, (int)(synthVars.osc[1].GetPulseWidth() * 100.0), 5, 95, { 114, 42 }, { 96, 18 });
+	Bind(wxEVT_SLIDER, &MyFrame::OnOscPulseWidth, this, ID_PulseWidth2);
+	wxStaticText *pwLabel2 = new wxStaticText(oscPanel[1], wxID_ANY, "Width", { 148, 60 });
+
+	//oscillator 1 is the sync master
+	wxCheckBox *checkSync = new wxCheckBox(oscPanel[1], ID_Sync2, "Sync", { 166, 78 });
+	checkSync->SetValue(synthVars.osc[1].GetSync());
+	Bind(wxEVT_CHECKBOX, &MyFrame::OnOscSync, this, ID_Sync2);
+
+	wxCheckBox *checkFreeRun2 = new wxCheckBox(oscPanel[1], ID_FreeRun2, "Free", { 166, 100 });
+	checkFreeRun2->SetValue(synthVars.osc[1].GetFreeRun());
+	Bind(wxEVT_CHECKBOX, &MyFrame::OnOscFreeRun, this, ID_FreeRun2);
+
 
 	//envelope
 	wxPanel *envPanel = new wxPanel(mainPanel, wxID_ANY, { 320, 6 }, { 175, 150 }, wxSIMPLE_BORDER);
@@ -531,10 +661,152 @@ MyFrame::MyFrame()
 	Bind(wxEVT_SLIDER, &MyFrame::OnResonance, this, ID_Resonance1);
 	wxStaticText *resLabel = new wxStaticText(ftrPanel, wxID_ANY, "Resonance", { 38, 60 });
 
+	wxChoice *fltrMode = new wxChoice(ftrPanel, ID_FltrMode1, { 6, 90 }, wxDefaultSize);
+	fltrMode->Append(vector<wxString>({ "Low Pass", "High Pass", "Band Pass", "Notch", "Peak" }));
+	fltrMode->SetSelection(0);
+	Bind(wxEVT_CHOICE, &MyFrame::OnFltrMode, this, ID_FltrMode1);
+
 	wxChoice *fltrPoles = new wxChoice(ftrPanel, ID_FltrPoles1, { 6, 120 }, wxDefaultSize);
-	fltrPoles->Append(vector<wxString>({ "12 dB/Oct", "24 dB/Oct" }));
+	fltrPoles->Append(vector<wxString>({ "12 dB/Oct", "24 dB/Oct", "Ladder 2x", "Ladder 4x" }));
 	fltrPoles->SetSelection(0);
 	Bind(wxEVT_CHOICE, &MyFrame::OnFltrPoles, this, ID_FltrPoles1);
+
+
+	//delay
+	wxPanel *dlyPanel = new wxPanel(mainPanel, wxID_ANY, { 500, 6 }, { 175, 150 }, wxSIMPLE_BORDER);
+
+	wxSlider *dlyTimeSlider = new wxSlider(dlyPanel, ID_DlyTime1, 1000 - (int)LogToLin(synthVars.delay.GetTime(), 10.0, DELAY_MAX_TIME, 1.0, 1000.0), 1, 1000, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDelay, this, ID_DlyTime1);
+	wxStaticText *dlyTimeLabel = new wxStaticText(dlyPanel, wxID_ANY, "T", { 14, 104 });
+
+	wxSlider *dlyFbSlider = new wxSlider(dlyPanel, ID_DlyFeedback1, 100 - (int)(synthVars.delay.GetFeedback() * 100.0), 5, 100, { 30, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDelay, this, ID_DlyFeedback1);
+	wxStaticText *dlyFbLabel = new wxStaticText(dlyPanel, wxID_ANY, "F", { 38, 104 });
+
+	wxSlider *dlyToneSlider = new wxSlider(dlyPanel, ID_DlyTone1, 100 - (int)LogToLin(synthVars.delay.GetTone(), 500.0, 20000.0, 1.0, 100.0), 1, 100, { 54, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDelay, this, ID_DlyTone1);
+	wxStaticText *dlyToneLabel = new wxStaticText(dlyPanel, wxID_ANY, "C", { 62, 104 });
+
+	wxSlider *dlyMixSlider = new wxSlider(dlyPanel, ID_DlyMix1, 100 - (int)(synthVars.delay.GetMix() * 100.0), 0, 100, { 78, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDelay, this, ID_DlyMix1);
+	wxStaticText *dlyMixLabel = new wxStaticText(dlyPanel, wxID_ANY, "M", { 86, 104 });
+
+	wxCheckBox *dlyPingPong = new wxCheckBox(dlyPanel, ID_DlyPingPong1, "Ping-Pong", { 104, 8 });
+	Bind(wxEVT_CHECKBOX, &MyFrame::OnDelayPingPong, this, ID_DlyPingPong1);
+
+	wxChoice *dlySync = new wxChoice(dlyPanel, ID_DlySync1, { 6, 120 }, wxDefaultSize);
+	dlySync->Append(vector<wxString>({ "Free", "1/4", "1/8", "1/8 Dotted", "1/8 Triplet", "1/16" }));
+	dlySync->SetSelection(0);
+	Bind(wxEVT_CHOICE, &MyFrame::OnDelaySync, this, ID_DlySync1);
+
+
+	//reverb
+	wxPanel *rvbPanel = new wxPanel(mainPanel, wxID_ANY, { 500, 160 }, { 175, 150 }, wxSIMPLE_BORDER);
+
+	wxSlider *rvbSizeSlider = new wxSlider(rvbPanel, ID_RvbSize1, 100 - (int)(synthVars.reverb.GetSize() / REVERB_MAX_SIZE * 100.0), 13, 100, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnReverb, this, ID_RvbSize1);
+	wxStaticText *rvbSizeLabel = new wxStaticText(rvbPanel, wxID_ANY, "S", { 14, 104 });
+
+	wxSlider *rvbDecaySlider = new wxSlider(rvbPanel, ID_RvbDecay1, 1000 - (int)LogToLin(synthVars.reverb.GetDecay(), 0.1, 20.0, 1.0, 1000.0), 1, 1000, { 30, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnReverb, this, ID_RvbDecay1);
+	wxStaticText *rvbDecayLabel = new wxStaticText(rvbPanel, wxID_ANY, "D", { 38, 104 });
+
+	wxSlider *rvbDampingSlider = new wxSlider(rvbPanel, ID_RvbDamping1, 100 - (int)(synthVars.reverb.GetDamping() * 100.0), 0, 100, { 54, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnReverb, this, ID_RvbDamping1);
+	wxStaticText *rvbDampingLabel = new wxStaticText(rvbPanel, wxID_ANY, "H", { 62, 104 });
+
+	wxSlider *rvbMixSlider = new wxSlider(rvbPanel, ID_RvbMix1, 100 - (int)(synthVars.reverb.GetMix() * 100.0), 0, 100, { 78, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnReverb, this, ID_RvbMix1);
+	wxStaticText *rvbMixLabel = new wxStaticText(rvbPanel, wxID_ANY, "M", { 86, 104 });
+
+	wxChoice *rvbMatrix = new wxChoice(rvbPanel, ID_RvbMatrix1, { 6, 120 }, wxDefaultSize);
+	rvbMatrix->Append(vector<wxString>({ "Hadamard", "Householder" }));
+	rvbMatrix->SetSelection(synthVars.reverb.GetMatrix());
+	Bind(wxEVT_CHOICE, &MyFrame::OnReverbMatrix, this, ID_RvbMatrix1);
+
+
+	//convolution
+	wxPanel *convPanel = new wxPanel(mainPanel, wxID_ANY, { 320, 314 }, { 175, 150 }, wxSIMPLE_BORDER);
+
+	wxSlider *convMixSlider = new wxSlider(convPanel, ID_ConvMix1, 100 - (int)(synthVars.convolver.GetMix() * 100.0), 0, 100, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnConvolverMix, this, ID_ConvMix1);
+	wxStaticText *convMixLabel = new wxStaticText(convPanel, wxID_ANY, "M", { 14, 104 });
+
+	wxButton *convLoadButton = new wxButton(convPanel, ID_ConvLoad1, "Load IR...", { 6, 120 });
+	Bind(wxEVT_BUTTON, &MyFrame::OnConvolverLoad, this, ID_ConvLoad1);
+
+
+	//modulation effects
+	wxPanel *modPanel = new wxPanel(mainPanel, wxID_ANY, { 500, 314 }, { 175, 150 }, wxSIMPLE_BORDER);
+
+	wxSlider *modRateSlider = new wxSlider(modPanel, ID_ModRate1, 1000 - (int)LogToLin(synthVars.modEffects.GetRate(), 0.05, 10.0, 1.0, 1000.0), 1, 1000, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnModEffects, this, ID_ModRate1);
+	wxStaticText *modRateLabel = new wxStaticText(modPanel, wxID_ANY, "R", { 14, 104 });
+
+	wxSlider *modDepthSlider = new wxSlider(modPanel, ID_ModDepth1, 100 - (int)(synthVars.modEffects.GetDepth() * 100.0), 0, 100, { 30, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnModEffects, this, ID_ModDepth1);
+	wxStaticText *modDepthLabel = new wxStaticText(modPanel, wxID_ANY, "D", { 38, 104 });
+
+	wxSlider *modFbSlider = new wxSlider(modPanel, ID_ModFeedback1, 100 - (int)((synthVars.modEffects.GetFeedback() / 0.95 + 1.0) * 50.0), 0, 100, { 54, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnModEffects, this, ID_ModFeedback1);
+	wxStaticText *modFbLabel = new wxStaticText(modPanel, wxID_ANY, "F", { 62, 104 });
+
+	wxSlider *modMixSlider = new wxSlider(modPanel, ID_ModMix1, 100 - (int)(synthVars.modEffects.GetMix() * 100.0), 0, 100, { 78, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnModEffects, this, ID_ModMix1);
+	wxStaticText *modMixLabel = new wxStaticText(modPanel, wxID_ANY, "M", { 86, 104 });
+
+	wxChoice *modType = new wxChoice(modPanel, ID_ModType1, { 6, 120 }, wxDefaultSize);
+	modType->Append(vector<wxString>({ "Off", "Chorus", "Ensemble", "Flanger", "Phaser" }));
+	modType->SetSelection(synthVars.modEffects.GetType());
+	Bind(wxEVT_CHOICE, &MyFrame::OnModEffectsType, this, ID_ModType1);
+
+
+	//distortion, below the effects so the master slider keeps the right column
+	wxPanel *distPanel = new wxPanel(mainPanel, wxID_ANY, { 320, 468 }, { 175, 150 }, wxSIMPLE_BORDER);
+	double dCrushRate = synthVars.distortion.GetCrushRate();
+
+	wxSlider *distDriveSlider = new wxSlider(distPanel, ID_DistDrive1, 360 - (int)(synthVars.distortion.GetDrive() * 10.0), 0, 360, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDistortion, this, ID_DistDrive1);
+	wxStaticText *distDriveLabel = new wxStaticText(distPanel, wxID_ANY, "D", { 14, 104 });
+
+	wxSlider *distBitsSlider = new wxSlider(distPanel, ID_DistBits1, DIST_MAX_BITS + 1 - (int)synthVars.distortion.GetBits(), 1, DIST_MAX_BITS, { 30, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDistortion, this, ID_DistBits1);
+	wxStaticText *distBitsLabel = new wxStaticText(distPanel, wxID_ANY, "B", { 38, 104 });
+
+	wxSlider *distRateSlider = new wxSlider(distPanel, ID_DistRate1, 1000 - (int)LogToLin(dCrushRate > 0.0 ? dCrushRate : SAMPLE_RATE, 500.0, SAMPLE_RATE, 1.0, 1000.0), 1, 1000, { 54, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDistortion, this, ID_DistRate1);
+	wxStaticText *distRateLabel = new wxStaticText(distPanel, wxID_ANY, "R", { 62, 104 });
+
+	wxSlider *distMixSlider = new wxSlider(distPanel, ID_DistMix1, 100 - (int)(synthVars.distortion.GetMix() * 100.0), 0, 100, { 78, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDistortion, this, ID_DistMix1);
+	wxStaticText *distMixLabel = new wxStaticText(distPanel, wxID_ANY, "M", { 86, 104 });
+
+	wxChoice *distCurve = new wxChoice(distPanel, ID_DistCurve1, { 6, 120 }, { 90, -1 });
+	distCurve->Append(vector<wxString>({ "Off", "Atan", "Tanh", "Asymmetric", "Foldback" }));
+	distCurve->SetSelection(synthVars.distortion.GetCurve());
+	Bind(wxEVT_CHOICE, &MyFrame::OnDistortionCurve, this, ID_DistCurve1);
+
+
+	//master dynamics, compressor threshold and ratio, limiter gain and ceiling
+	wxPanel *dynPanel = new wxPanel(mainPanel, wxID_ANY, { 500, 468 }, { 175, 150 }, wxSIMPLE_BORDER);
+
+	wxSlider *compThresholdSlider = new wxSlider(dynPanel, ID_CompThreshold1, -(int)synthVars.compressor.GetThreshold(), 0, 40, { 6, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDynamics, this, ID_CompThreshold1);
+	wxStaticText *compThresholdLabel = new wxStaticText(dynPanel, wxID_ANY, "T", { 14, 104 });
+
+	wxSlider *compRatioSlider = new wxSlider(dynPanel, ID_CompRatio1, (int)(COMP_MAX_RATIO * 10.0) + 10 - (int)(synthVars.compressor.GetRatio() * 10.0), 10, (int)(COMP_MAX_RATIO * 10.0), { 30, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDynamics, this, ID_CompRatio1);
+	wxStaticText *compRatioLabel = new wxStaticText(dynPanel, wxID_ANY, "R", { 38, 104 });
+
+	wxSlider *limGainSlider = new wxSlider(dynPanel, ID_LimGain1, (int)(LIMITER_MAX_GAIN * 10.0) - (int)(synthVars.limiter.GetGain() * 10.0), 0, (int)(LIMITER_MAX_GAIN * 10.0), { 54, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDynamics, this, ID_LimGain1);
+	wxStaticText *limGainLabel = new wxStaticText(dynPanel, wxID_ANY, "G", { 62, 104 });
+
+	wxSlider *limCeilingSlider = new wxSlider(dynPanel, ID_LimCeiling1, -(int)(synthVars.limiter.GetCeiling() * 10.0), 0, 120, { 78, 6 }, wxDefaultSize, wxSL_VERTICAL);
+	Bind(wxEVT_SLIDER, &MyFrame::OnDynamics, this, ID_LimCeiling1);
+	wxStaticText *limCeilingLabel = new wxStaticText(dynPanel, wxID_ANY, "C", { 86, 104 });
+
+	wxStaticText *dynLabel = new wxStaticText(dynPanel, wxID_ANY, "Comp / Limit", { 6, 124 });
 }
 
 void MyFrame::OnExit(wxCommandEvent& event)
@@ -575,6 +847,9 @@ void MyFrame::OnMasterGauge(wxTimerEvent & event)
 	/*unique_lock<mutex> outputMutex(synthVars.muxRWOutput);
 	synthVars.cvIsOutputProcessed.wait(outputMutex);*/
 
+	//note offs a full queue held back
+	synthVars.voices.Flush();
+
 	//calculate RMS for Output Signal
 	double dRMSVolume[2] = { 0.0, 0.0 };
 
@@ -600,7 +875,10 @@ void MyFrame::OnMasterGauge(wxTimerEvent & event)
 
 	//level + benchmarking
 	//SetStatusText(wxString::Format("dB: %.2f    Benchmarks: osc: %.4f, mod: %.4f, fltr: %.4f, buff: %.4f, sample: %.4f", dB, bench.waveGen.load(), bench.modulation.load(), bench.filter.load(), bench.outputBuffer.load(), 1000.0/41000.0));
-	SetStatusText(wxString::Format("dB: %.2f", dB));
+	const char *sConvolver[] = { "none", "loading", "ready", "failed" };
+
+	SetStatusText(wxString::Format("dB: %.2f    Reverb load: %.1f%%    IR: %s    Comp: %.1f dB    Limit: %.1f dB (%.1f ms)    Dropped events: %u", dB, synthVars.reverb.GetLoad() * 100.0, sConvolver[synthVars.convolver.GetStatus()],
+		synthVars.compressor.GetReduction(), synthVars.limiter.GetReduction(), synthVars.limiter.GetLatency() * 1000.0 / SAMPLE_RATE, synthVars.voices.GetDroppedEvents()));
 
 	double dMinDB = 20 * log10(0.001 / 1.0); //-60 dB
 	double dMaxDB = 0.0;
@@ -734,6 +1012,59 @@ void MyFrame::OnOscRouting(wxCommandEvent & event)
 
 }
 
+void MyFrame::OnOscEngine(wxCommandEvent & event)
+{
+	wxChoice *c = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (c)
+	{
+		int id = c->GetId() - ID_Engine1;
+
+		synthVars.osc[id].SetEngine(c->GetSelection());
+	}
+	SetFocus();
+}
+
+void MyFrame::OnOscPulseWidth(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int id = s->GetId() - ID_PulseWidth1;
+
+		synthVars.osc[id].SetPulseWidth(s->GetValue() / 100.0);
+		SetStatusText(wxString::Format("Pulse Width %d: %d%%", id + 1, s->GetValue()));
+	}
+	SetFocus();
+}
+
+void MyFrame::OnOscSync(wxCommandEvent & event)
+{
+	wxCheckBox *cb = dynamic_cast<wxCheckBox*>(event.GetEventObject());
+
+	if (cb)
+	{
+		int id = cb->GetId() - ID_Sync1;
+
+		synthVars.osc[id].SetSync(cb->GetValue());
+	}
+	SetFocus();
+}
+
+void MyFrame::OnOscFreeRun(wxCommandEvent & event)
+{
+	wxCheckBox *cb = dynamic_cast<wxCheckBox*>(event.GetEventObject());
+
+	if (cb)
+	{
+		int id = cb->GetId() - ID_FreeRun1;
+
+		synthVars.osc[id].SetFreeRun(cb->GetValue());
+	}
+	SetFocus();
+}
+
 void MyFrame::OnOscLFO(wxCommandEvent & event)
 {
 	wxCheckBox *cb = dynamic_cast<wxCheckBox*>(event.GetEventObject());
@@ -825,6 +1156,8 @@ void MyFrame::OnEnvelope(wxCommandEvent & event)
 			else
 				synthVars.ADSR.SetRelease((51 - s->GetValue()) * 196.078);
 		}
+
+		synthVars.voices.SetEnvelope(synthVars.ADSR.GetParameters());
 	}
 
 	SetFocus();
@@ -881,8 +1214,257 @@ void MyFrame::OnFltrPoles(wxCommandEvent & event)
 
 	if (cb)
 	{
-		synthVars.bFourthOrder = cb->GetSelection() ? true : false;
+		int nSelection = cb->GetSelection();
+
+		synthVars.bFourthOrder = nSelection ? true : false;
+		synthVars.nLadder = nSelection == 2 ? 2 : (nSelection == 3 ? 4 : 0);
+	}
+}
+
+void MyFrame::OnFltrMode(wxCommandEvent & event)
+{
+	wxChoice *cb = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (cb)
+	{
+		synthVars.nFilterMode = cb->GetSelection(); //choices are in SVF_ order
+	}
+}
+
+void MyFrame::OnDelay(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int sID = s->GetId();
+
+		if (sID == ID_DlyTime1)
+		{
+			synthVars.delay.SetTime(LinToLog(1000 - s->GetValue(), 1.0, 1000.0, 10.0, DELAY_MAX_TIME));
+		}
+		else if (sID == ID_DlyFeedback1)
+		{
+			synthVars.delay.SetFeedback((100 - s->GetValue()) / 100.0);
+		}
+		else if (sID == ID_DlyTone1)
+		{
+			synthVars.delay.SetTone(LinToLog(100 - s->GetValue(), 1.0, 100.0, 500.0, 20000.0));
+		}
+		else if (sID == ID_DlyMix1)
+		{
+			synthVars.delay.SetMix((100 - s->GetValue()) / 100.0);
+		}
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnDelaySync(wxCommandEvent & event)
+{
+	wxChoice *cb = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (cb)
+	{
+		const double dBeats[] = { 0.0, 1.0, 0.5, 0.75, 1.0 / 3.0, 0.25 }; //note lengths of the choices, free time first
+
+		synthVars.delay.SetSync(dBeats[cb->GetSelection()]);
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnDelayPingPong(wxCommandEvent & event)
+{
+	wxCheckBox *cb = dynamic_cast<wxCheckBox*>(event.GetEventObject());
+
+	if (cb)
+	{
+		synthVars.delay.SetPingPong(cb->GetValue());
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnReverb(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int sID = s->GetId();
+
+		if (sID == ID_RvbSize1)
+		{
+			synthVars.reverb.SetSize((100 - s->GetValue()) / 100.0 * REVERB_MAX_SIZE);
+		}
+		else if (sID == ID_RvbDecay1)
+		{
+			synthVars.reverb.SetDecay(LinToLog(1000 - s->GetValue(), 1.0, 1000.0, 0.1, 20.0));
+		}
+		else if (sID == ID_RvbDamping1)
+		{
+			synthVars.reverb.SetDamping((100 - s->GetValue()) / 100.0);
+		}
+		else if (sID == ID_RvbMix1)
+		{
+			synthVars.reverb.SetMix((100 - s->GetValue()) / 100.0);
+		}
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnReverbMatrix(wxCommandEvent & event)
+{
+	wxChoice *cb = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (cb)
+	{
+		synthVars.reverb.SetMatrix(cb->GetSelection() == 1 ? REVERB_HOUSEHOLDER : REVERB_HADAMARD);
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnConvolverMix(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		synthVars.convolver.SetMix((100 - s->GetValue()) / 100.0);
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnConvolverLoad(wxCommandEvent & event)
+{
+	wxFileDialog fileDialog(this, "Load Impulse Response", "", "", "Wave files (*.wav)|*.wav", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+
+	if (fileDialog.ShowModal() == wxID_OK)
+	{
+		//the response is read and prepared in the background, the status bar shows when it is in use
+		if (!synthVars.convolver.Load(fileDialog.GetPath().ToStdString()))
+			wxMessageBox("Another impulse response is still loading.", "Load IR", wxOK | wxICON_INFORMATION);
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnModEffects(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int sID = s->GetId();
+
+		if (sID == ID_ModRate1)
+		{
+			synthVars.modEffects.SetRate(LinToLog(1000 - s->GetValue(), 1.0, 1000.0, 0.05, 10.0));
+		}
+		else if (sID == ID_ModDepth1)
+		{
+			synthVars.modEffects.SetDepth((100 - s->GetValue()) / 100.0);
+		}
+		else if (sID == ID_ModFeedback1)
+		{
+			synthVars.modEffects.SetFeedback(((100 - s->GetValue()) / 50.0 - 1.0) * 0.95);
+		}
+		else if (sID == ID_ModMix1)
+		{
+			synthVars.modEffects.SetMix((100 - s->GetValue()) / 100.0);
+		}
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnModEffectsType(wxCommandEvent & event)
+{
+	wxChoice *cb = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (cb)
+	{
+		synthVars.modEffects.SetType(cb->GetSelection()); //choices are in the order of the MOD_ types
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnDistortion(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int sID = s->GetId();
+
+		if (sID == ID_DistDrive1)
+		{
+			synthVars.distortion.SetDrive((360 - s->GetValue()) / 10.0);
+		}
+		else if (sID == ID_DistBits1)
+		{
+			synthVars.distortion.SetBits(DIST_MAX_BITS + 1 - s->GetValue());
+		}
+		else if (sID == ID_DistRate1)
+		{
+			//the top of the slider holds no samples
+			int nValue = 1000 - s->GetValue();
+
+			synthVars.distortion.SetCrushRate(nValue >= 1000 ? 0.0 : LinToLog(nValue, 1.0, 1000.0, 500.0, SAMPLE_RATE));
+		}
+		else if (sID == ID_DistMix1)
+		{
+			synthVars.distortion.SetMix((100 - s->GetValue()) / 100.0);
+		}
+	}
+
+	SetFocus();
+}
+
+void MyFrame::OnDistortionCurve(wxCommandEvent & event)
+{
+	wxChoice *cb = dynamic_cast<wxChoice*>(event.GetEventObject());
+
+	if (cb)
+	{
+		synthVars.distortion.SetCurve(cb->GetSelection()); //choices are in the order of the DIST_ curves
 	}
+
+	SetFocus();
+}
+
+void MyFrame::OnDynamics(wxCommandEvent & event)
+{
+	wxSlider *s = dynamic_cast<wxSlider*>(event.GetEventObject());
+
+	if (s)
+	{
+		int sID = s->GetId();
+
+		if (sID == ID_CompThreshold1)
+		{
+			synthVars.compressor.SetThreshold(-s->GetValue());
+		}
+		else if (sID == ID_CompRatio1)
+		{
+			synthVars.compressor.SetRatio((s->GetMax() + s->GetMin() - s->GetValue()) / 10.0); //the bottom of the slider is 1:1, off
+		}
+		else if (sID == ID_LimGain1)
+		{
+			synthVars.limiter.SetGain((s->GetMax() - s->GetValue()) / 10.0);
+		}
+		else if (sID == ID_LimCeiling1)
+		{
+			synthVars.limiter.SetCeiling(-s->GetValue() / 10.0);
+		}
+	}
+
+	SetFocus();
 }
 
 void MyFrame::OnPaint(wxPaintEvent & event)
@@ -921,44 +1503,21 @@ MyFrame::~MyFrame()
 		delete CfgButton;
 }
 
-double synthFunction(double d, byte channel)
+//renders one frame: every oscillator is generated once in mono, the mixer stage then pans it into each output channel
+void synthFrame(double *pFrame, unsigned int nChannels, unsigned int nFrame)
 {
 	double dOutputs[R_NUM_DEVS] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	double *dFree = synthVars.dOscFree;
 
 	const uint8_t *deviceMap = synthVars.deviceMap;	 
 
-	//auto tStart = std::chrono::high_resolution_clock::now();
+	VoicePool &voices = synthVars.voices;
+	int nVoices = voices.GetVoiceCount();
 
-	//Generate outputs from oscillators
-	for (int i = 0; i < 3; i++)
-	{
-		if (synthVars.osc[i].GetDrone())
-		{
-			dOutputs[i] = OSC_VOLUME * synthVars.osc[i].Play(synthVars.osc[i].GetFrequency(), d, channel);
-		}
-		else
-		{
-			for (auto note : synthVars.vNotesOn)
-			{
-					uint8_t nSemiTone = note + synthVars.osc[i].GetOctaveMod()*12;
-					if (nSemiTone >= 12 * 9 || nSemiTone < 0) continue;
-					//double dFrequency = C_SHARP_0 * pow(2, nSemiTone / 12.0);
-					if (routingMatrix[R_ENV][R_MIXR_A])
-						dOutputs[i] += synthVars.ADSR.GetAmplitude() * OSC_VOLUME * synthVars.osc[i].Play(synthVars.dNotes[nSemiTone], d, channel);
-					/*else if (synthVars.numKeysDown > 0)*/
-					else
-						dOutputs[i] += OSC_VOLUME * synthVars.osc[i].Play(synthVars.dNotes[nSemiTone], d, channel);
-			}
-		}
-	}
-
-	/*auto tOsc = std::chrono::high_resolution_clock::now();
-	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tOsc - tStart).count();
-	bench.waveGen.store(duration);
+	//auto tStart = std::chrono::high_resolution_clock::now();
 
-	tStart = std::chrono::high_resolution_clock::now();*/
-	//Check Routing Matrix
-	for (int i = 0; i < R_NUM_ROUTES; i++)
+	//Check Routing Matrix, modulation uses the oscillator outputs of the previous frame
+	for (int i = 0; i < R_FLTR_I; i++)
 	{
 		if (i == R_OSC1_P || i == R_OSC2_P || i == R_OSC3_P)
 		{
@@ -969,14 +1528,10 @@ double synthFunction(double d, byte channel)
 			{
 				if (routingMatrix[m][i])
 				{
-					synthVars.osc[deviceMap[i]].AddFM(0.25 * synthVars.osc[deviceMap[i]].GetFrequency() * synthVars.osc[m].Play(synthVars.osc[m].GetFrequency(), d, channel));
+					synthVars.osc[deviceMap[i]].AddFM(0.25 * synthVars.osc[deviceMap[i]].GetFrequency() * dFree[m]);
 				}
 
 			}
-
-			//regenerate outputs
-			if (synthVars.osc[deviceMap[i]].GetDrone())
-				dOutputs[deviceMap[i]] = OSC_VOLUME * synthVars.osc[deviceMap[i]].Play(synthVars.osc[deviceMap[i]].GetFrequency(), d, channel);
 		}
 		else if (i == R_OSC1_A || i == R_OSC2_A || i == R_OSC3_A)
 		{
@@ -987,105 +1542,289 @@ double synthFunction(double d, byte channel)
 			{
 				if (routingMatrix[m][i])
 				{
-					double dAM = synthVars.osc[m].Play(synthVars.osc[m].GetFrequency(), d, channel) + (1.0 - synthVars.osc[m].GetVolume());
+					double dAM = dFree[m] + (1.0 - synthVars.osc[m].GetVolume());
 					synthVars.osc[deviceMap[i]].AddAM(dAM);
 				}
 			}
-
-			//regenerate outputs
-			if (synthVars.osc[deviceMap[i]].GetDrone())
-				dOutputs[deviceMap[i]] = OSC_VOLUME * synthVars.osc[deviceMap[i]].Play(synthVars.osc[deviceMap[i]].GetFrequency(), d, channel);
 		}
-		else if (i == R_FLTR_I) //Filter input
-		{
-			/*auto tMod = std::chrono::high_resolution_clock::now();
-			auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tMod - tStart).count();
-			bench.modulation.store(duration);
+	}
 
-			tStart = std::chrono::high_resolution_clock::now();*/
+	/*auto tMod = std::chrono::high_resolution_clock::now();
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tMod - tStart).count();
+	bench.modulation.store(duration);
 
-			for (int j = 0; j < 3; j++)
-			{
-				dOutputs[R_FLTR] += routingMatrix[j][R_FLTR_I] ? dOutputs[j] : 0.0;
-			}			
+	tStart = std::chrono::high_resolution_clock::now();*/
+
+	//Generate outputs from oscillators, each phase advances exactly once per frame
+	for (int i = 0; i < 3; i++)
+	{
+		bool bModulator = false;
+
+		for (int r = 0; r < R_FLTR_I; r++)
+			bModulator |= routingMatrix[i][r];
+
+		//free running output at the oscillator frequency, used by drones and as modulation source
+		if (synthVars.osc[i].GetDrone() || bModulator || routingMatrix[i][R_FLTR_C])
+			dFree[i] = synthVars.osc[i].Play(synthVars.osc[i].GetFrequency());
+
+		if (synthVars.osc[i].GetDrone())
+		{
+			dOutputs[i] = OSC_VOLUME * dFree[i];
 		}
-		else if (i == R_FLTR_C) //Filter cutoff modulation
+		else
 		{
-			double dCutoff = synthVars.nFilterCutoff;
+			bool bSync = i > 0 && synthVars.osc[i].GetSync(); //oscillators 2 and 3 can be hard synced to oscillator 1
+			OscillatorBank &bank = synthVars.noteBank[i];
+			double dGains[BANK_MAX_VOICES];
 
-			for (int j = 0; j < 3; j++)
+			for (int k = 0; k < nVoices; k++)
 			{
-				if (routingMatrix[j][R_FLTR_C]) //osc modulation
-				{
-					double dMod = synthVars.osc[j].Play(synthVars.osc[j].GetFrequency(), d, channel) + (1.0 - synthVars.osc[j].GetVolume());
-					double dScale = LinToLog(dMod, -1.0, 1.0, 0.001, 1.0);
+				Voice &voice = voices.GetVoice(k);
+				int nSemiTone = voice.nNote + synthVars.osc[i].GetOctaveMod() * 12;
 
-					dCutoff *= dScale;
+				//free voices and notes out of range stay silent, a stopped master never syncs its slaves
+				if (!voice.bActive)
+					dGains[k] = 0.0;
+				else if (nSemiTone >= 12 * 9 || nSemiTone < 0)
+				{
+					synthVars.osc[i].SetVoice(bank, k, 0.0);
+					dGains[k] = 0.0;
+				}
+				else
+				{
+					synthVars.osc[i].SetVoice(bank, k, synthVars.dNotes[nSemiTone]);
+					dGains[k] = routingMatrix[R_ENV][R_MIXR_A] ? voice.dEnvelope[nFrame] : 1.0;
 				}
 			}
 
-			if (routingMatrix[R_ENV][R_FLTR_C]) //env modulation
+			bank.SetVoiceCount(nVoices);
+
+			if (bSync)
 			{
-				double dMod = synthVars.ADSR.GetAmplitude();
-				double dScale = LinToLog(dMod, 0.0, 1.0, 0.000001, 1.0);
+				//oscillator 1 already played this frame, either as drone or with its own bank
+				if (synthVars.osc[0].GetDrone())
+				{
+					const oscPhase &phase = synthVars.osc[0].GetPhase();
+					bankMaster master = { &phase.dPhase, &phase.dIncrement, true };
+
+					dOutputs[i] = OSC_VOLUME * synthVars.osc[i].Play(bank, dGains, &master);
+				}
+				else
+				{
+					bankMaster master = synthVars.noteBank[0].GetMaster();
 
-				dCutoff *= dScale;
+					dOutputs[i] = OSC_VOLUME * synthVars.osc[i].Play(bank, dGains, &master);
+				}
 			}
+			else
+				dOutputs[i] = OSC_VOLUME * synthVars.osc[i].Play(bank, dGains);
+		}
+	}
 
-			//Apply Low Pass Filtering to signals going through filter	
-			static double dDelayBuffer[2][2] = { {0.0, 0.0}, {0.0, 0.0} };
-			static double dDelayBuffer2[2][2] = { {0.0, 0.0}, {0.0, 0.0} };
-			
-			dOutputs[R_FLTR] = StateVLowPass(dOutputs[R_FLTR], dDelayBuffer[channel], dCutoff, synthVars.dResonance); //-6 dB/Oct
-			//second order
-			dOutputs[R_FLTR] = StateVLowPass(dOutputs[R_FLTR], dDelayBuffer2[channel], dCutoff, synthVars.dResonance); //-12 dB/Oct
+	/*auto tOsc = std::chrono::high_resolution_clock::now();
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tOsc - tStart).count();
+	bench.waveGen.store(duration);
+
+	tStart = std::chrono::high_resolution_clock::now();*/
+
+	//Filter cutoff modulation, in octaves so every modulator only adds to the pitch
+	if (synthVars.nPitchCutoff != synthVars.nFilterCutoff)
+	{
+		synthVars.nPitchCutoff = synthVars.nFilterCutoff;
+		synthVars.dCutoffPitch = FilterPitch(synthVars.nPitchCutoff, SAMPLE_RATE);
+	}
+
+	double dPitch = synthVars.dCutoffPitch;
+
+	for (int j = 0; j < 3; j++)
+	{
+		if (routingMatrix[j][R_FLTR_C]) //osc modulation
+		{
+			double dMod = dFree[j] + (1.0 - synthVars.osc[j].GetVolume());
+
+			dPitch += (dMod - 1.0) * FLTR_OSC_DEPTH;
+		}
+	}
+
+	//every voice filters its own part of the oscillators routed to the filter, drones have no voice and go through the shared filter below
+	double dVoiceFilter[MAX_CHANNELS] = { 0.0, 0.0, 0.0, 0.0 };
+	double dFilterGain[3][MAX_CHANNELS];
+	bool bVoiceFilter = false;
+
+	for (int j = 0; j < 3; j++)
+	{
+		bool bRouted = routingMatrix[j][R_FLTR_I] && !synthVars.osc[j].GetDrone();
+
+		for (unsigned int n = 0; n < nChannels; n++)
+			dFilterGain[j][n] = bRouted ? OSC_VOLUME * synthVars.osc[j].GetAmplitude() * synthVars.osc[j].GetChannelVolume(n) : 0.0;
+
+		bVoiceFilter |= bRouted;
+	}
 
-			if (synthVars.bFourthOrder)
+	int nStages = synthVars.bFourthOrder ? 4 : 2; //-12 or -24 dB/Oct
+	int nFilterType = synthVars.nLadder ? FILTER_LADDER : FILTER_SVF;
+
+	if (bVoiceFilter)
+	{
+		FilterBank &filter = voices.GetFilter();
+		double *pPitch = filter.GetPitches();
+
+		for (int k = 0; k < nVoices; k++)
+		{
+			Voice &voice = voices.GetVoice(k);
+
+			pPitch[k] = dPitch;
+
+			if (routingMatrix[R_ENV][R_FLTR_C] && voice.bActive) //env modulation
+				pPitch[k] += (voice.dEnvelope[nFrame] - 1.0) * FLTR_ENV_DEPTH;
+		}
+
+		for (unsigned int n = 0; n < nChannels; n++)
+		{
+			double *pInput = filter.GetInputs(n);
+
+			//free voices get no input, their filters ring out
+			for (int k = 0; k < nVoices; k++)
+				pInput[k] = 0.0;
+
+			for (int j = 0; j < 3; j++)
 			{
-				static double dDelayBuffer3[2][2] = { {0.0, 0.0}, {0.0, 0.0} };
-				static double dDelayBuffer4[2][2] = { {0.0, 0.0}, {0.0, 0.0} };
+				const double *pOutputs = synthVars.noteBank[j].GetOutputs();
+
+				if (dFilterGain[j][n] == 0.0)
+					continue;
 
-				dOutputs[R_FLTR] = StateVLowPass(dOutputs[R_FLTR], dDelayBuffer3[channel], dCutoff, synthVars.dResonance);
-				dOutputs[R_FLTR] = StateVLowPass(dOutputs[R_FLTR], dDelayBuffer4[channel], dCutoff, synthVars.dResonance); //-24 dB/Oct
+				for (int k = 0; k < nVoices; k++)
+					pInput[k] += dFilterGain[j][n] * pOutputs[k];
 			}
+		}
+
+		//every voice in its own lane, all stages of a channel in one pass
+		filter.SetVoiceCount(nVoices);
+		filter.SetType(nFilterType);
+		filter.SetOversampling(synthVars.nLadder);
+		filter.SetStages(nStages);
+		filter.SetMode(synthVars.nFilterMode);
+		filter.SetQ(synthVars.dResonance);
+		filter.Process(dVoiceFilter, nChannels);
+	}
 
-			/*auto tFltr = std::chrono::high_resolution_clock::now();
-			auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tFltr - tStart).count();
-			bench.filter.store(duration);*/
+	//Filter input, drones only
+	double dDroneFilter[MAX_CHANNELS] = { 0.0, 0.0, 0.0, 0.0 };
+	bool bDroneFilter = false;
 
+	for (int j = 0; j < 3; j++)
+	{
+		if (routingMatrix[j][R_FLTR_I] && synthVars.osc[j].GetDrone())
+		{
+			for (unsigned int n = 0; n < nChannels; n++)
+				dDroneFilter[n] += dOutputs[j] * synthVars.osc[j].GetChannelVolume(n);
+
+			bDroneFilter = true;
 		}
-		else if (i == R_MIXR_A)
+	}
+
+	//Apply Low Pass Filtering to signals going through filter
+	if (bDroneFilter)
+	{
+		FilterBank &filter = synthVars.droneFilter;
+
+		for (unsigned int n = 0; n < nChannels; n++)
+			filter.GetInputs(n)[0] = dDroneFilter[n];
+
+		filter.GetPitches()[0] = dPitch;
+		filter.SetVoiceCount(1);
+		filter.SetType(nFilterType);
+		filter.SetOversampling(synthVars.nLadder);
+		filter.SetStages(nStages);
+		filter.SetMode(synthVars.nFilterMode);
+		filter.SetQ(synthVars.dResonance);
+		filter.Process(dDroneFilter, nChannels);
+	}
+
+	//Mixer, pan every device into the output channels
+
+	for (unsigned int n = 0; n < nChannels; n++)
+	{
+		double dPanned[3];
+		double dMix = 0.0;
+
+		for (int j = 0; j < 3; j++)
+			dPanned[j] = dOutputs[j] * synthVars.osc[j].GetChannelVolume(n);
+
+		double dFilter = dDroneFilter[n] + dVoiceFilter[n];
+
+		/*auto tFltr = std::chrono::high_resolution_clock::now();
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tFltr - tStart).count();
+		bench.filter.store(duration);*/
+
+		for (int j = 0; j < 3; j++)
+			dMix += routingMatrix[j][R_MIXR_A] ? dPanned[j] : 0.0;
+
+		dMix += routingMatrix[R_FLTR][R_MIXR_A] ? dFilter : 0.0;
+
+		pFrame[n] = dMix * (synthVars.nMasterVolume / 100.0);
+	}
+}
+
+//renders a whole block of interleaved frames for the audio interface
+void synthBlock(double *pBlock, unsigned int nFrames, unsigned int nChannels, uint64_t nStartFrame)
+{
+	//note events from the GUI take effect at block boundaries, (re)started voices begin their waveforms from the start
+	synthVars.voices.ProcessEvents();
+
+	for (int k = 0; k < synthVars.voices.GetVoiceCount(); k++)
+	{
+		Voice &voice = synthVars.voices.GetVoice(k);
+
+		if (voice.bStarted)
 		{
-			for (int j = 0; j < R_NUM_DEVS-1; j++)
-				dOutputs[R_MIXR] += routingMatrix[j][R_MIXR_A] ? dOutputs[j] : 0.0;
+			for (int o = 0; o < 3; o++)
+				synthVars.osc[o].ResetVoice(synthVars.noteBank[o], k);
+
+			voice.bStarted = false;
 		}
 	}
 
-	double dOut = dOutputs[R_MIXR] * (synthVars.nMasterVolume / 100.0);
+	//voice envelopes are computed a block at a time
+	for (unsigned int i = 0; i < nFrames; i += VOICE_BLOCK)
+	{
+		unsigned int nRun = nFrames - i < VOICE_BLOCK ? nFrames - i : VOICE_BLOCK;
+
+		synthVars.voices.Render(nRun);
+
+		for (unsigned int f = 0; f < nRun; f++)
+			synthFrame(pBlock + (i + f) * nChannels, nChannels, f);
+	}
+
+	//the distortion works on the summed voices before the dc blocker, which also takes off the offset of asymmetric curves
+	synthVars.distortion.Process(pBlock, nFrames, nChannels);
 
-	//quick distortion
-	//dOut = BitCrush(SoftClip(dOut, 20.0, 10.0));	
+	for (unsigned int i = 0; i < nFrames; i++)
+	{
+		for (unsigned int n = 0; n < nChannels; n++)
+			pBlock[i * nChannels + n] = synthVars.highPass[n].Process(pBlock[i * nChannels + n]); //filter off everything below 30Hz
+	}
 
-	//tStart = std::chrono::high_resolution_clock::now();
+	//master effects work on the whole block of summed voices
+	synthVars.modEffects.Process(pBlock, nFrames, nChannels);
+	synthVars.convolver.Process(pBlock, nFrames, nChannels);
+	synthVars.delay.Process(pBlock, nFrames, nChannels);
+	synthVars.reverb.Process(pBlock, nFrames, nChannels);
+	synthVars.compressor.Process(pBlock, nFrames, nChannels);
+	synthVars.limiter.Process(pBlock, nFrames, nChannels);
 
-	//unique_lock<mutex> outputMutex(synthVars.muxRWOutput);
+	//copy block to level meter buffer, output data is available after both channels have been processed
 	synthVars.bBuffReady.store(false);
-	synthVars.dOutputBuffer[channel][synthVars.nBufferPos] = dOut;
 
-	if (channel == CH_RIGHT) //let output data be available after both channels have been porcessed
+	for (unsigned int i = 0; i < nFrames; i++)
 	{
-		synthVars.bBuffReady.store(true);
+		synthVars.dOutputBuffer[CH_LEFT][synthVars.nBufferPos] = pBlock[i * nChannels + CH_LEFT];
+		synthVars.dOutputBuffer[CH_RIGHT][synthVars.nBufferPos] = nChannels > 1 ? pBlock[i * nChannels + CH_RIGHT] : pBlock[i * nChannels];
 
 		synthVars.nBufferPos++;
 		synthVars.nBufferPos %= AVERAGE_SAMPLES;
-
-		//synthVars.cvIsOutputProcessed.notify_one();		
 	}
-		
-	/*auto tBuff = std::chrono::high_resolution_clock::now();
-	duration = std::chrono::duration_cast<std::chrono::microseconds>(tBuff - tStart).count();
-	bench.outputBuffer.store(duration);*/
-	
-	static double dHPBuffer[2][2] = { {0.0, 0.0}, {0.0, 0.0 } };
-	return BiQuadHighPass(dOut, dHPBuffer[channel], 30.0, 1.0); //filter off everything below 30Hz
+
+	synthVars.bBuffReady.store(true);
 }
\ No newline at end of file
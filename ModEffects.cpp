@@ -0,0 +1,331 @@
+#include "ModEffects.h"
+#include "Oscillator.h"
+#include "SIMD.h"
+
+#include <cmath>
+
+//voices per channel, shortest delay and delay range at full depth in ms, lfo shape
+struct modLayout
+{
+	int nVoices;
+	double dBase;
+	double dRange;
+	int nShape;
+};
+
+static const modLayout modLayouts[MOD_PHASER + 1] =
+{
+	{ 0, 0.0, 0.0, LFO_SINE }, //off
+	{ 2, 7.0, 10.0, LFO_SINE }, //chorus
+	{ 3, 5.0, 6.0, LFO_SINE }, //ensemble, three voices a third of a cycle apart
+	{ 1, 0.3, 5.0, LFO_TRIANGLE }, //flanger
+	{ 1, 0.0, 0.0, LFO_TRIANGLE }, //phaser, one allpass cascade per channel
+};
+
+ModEffects::ModEffects()
+{
+	for (int i = 0; i < MOD_LANES; i++)
+	{
+		dChannel[i] = 0.0;
+		dLfo[i] = dLfoStep[i] = 0.0;
+		dCoeff[i] = dCoeffStep[i] = 0.0;
+
+		for (int c = 0; c < MOD_CHANNELS; c++)
+			dOutGain[c][i] = 0.0;
+	}
+
+	Reset();
+}
+
+ModEffects::~ModEffects()
+{
+}
+
+void ModEffects::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	line.SetLength(MOD_CHANNELS, (unsigned int)(MOD_MAX_DELAY * nSampleRate / 1000.0) + 4);
+	lfo.SetSampleRate(nSampleRate);
+	nLayoutType = -1; //delays in samples change with the rate
+}
+
+void ModEffects::SetType(int nType)
+{
+	this->nType = nType < MOD_OFF || nType > MOD_PHASER ? MOD_OFF : nType;
+}
+
+void ModEffects::SetRate(double dRate)
+{
+	this->dRate = dRate;
+}
+
+void ModEffects::SetDepth(double dDepth)
+{
+	this->dDepth = dDepth < 0.0 ? 0.0 : (dDepth > 1.0 ? 1.0 : dDepth);
+}
+
+void ModEffects::SetFeedback(double dFeedback)
+{
+	this->dFeedback = dFeedback < -0.95 ? -0.95 : (dFeedback > 0.95 ? 0.95 : dFeedback);
+}
+
+void ModEffects::SetMix(double dMix)
+{
+	this->dMix = dMix < 0.0 ? 0.0 : (dMix > 1.0 ? 1.0 : dMix);
+}
+
+int ModEffects::GetType()
+{
+	return nType;
+}
+
+double ModEffects::GetRate()
+{
+	return dRate;
+}
+
+double ModEffects::GetDepth()
+{
+	return dDepth;
+}
+
+double ModEffects::GetFeedback()
+{
+	return dFeedback;
+}
+
+double ModEffects::GetMix()
+{
+	return dMix;
+}
+
+void ModEffects::Reset()
+{
+	line.Reset();
+	lfo.Reset();
+	nRamp = 0;
+
+	for (int i = 0; i < MOD_LANES; i++)
+	{
+		for (int s = 0; s < MOD_PHASER_STAGES; s++)
+			dAllpass[s][i] = 0.0;
+
+		dLast[i] = 0.0;
+		dInput[i] = 0.0;
+	}
+}
+
+//lane v * nChannels + c is voice v of channel c, the channels run a quarter cycle apart for width
+void ModEffects::SetLayout(unsigned int nChannels)
+{
+	const modLayout &layout = modLayouts[nType];
+
+	nLanes = layout.nVoices * nChannels;
+	dBase = layout.dBase * nSampleRate / 1000.0;
+	dRange = layout.dRange * nSampleRate / 1000.0;
+
+	lfo.SetShape(layout.nShape);
+
+	for (int i = 0; i < MOD_LANES; i++)
+	{
+		int v = i / nChannels;
+		int c = i % nChannels;
+		bool bUsed = i < nLanes;
+
+		dChannel[i] = bUsed ? c : 0.0;
+		lfo.SetOffset(i, bUsed ? (double)v / layout.nVoices + 0.25 * c : 0.0);
+
+		for (int n = 0; n < MOD_CHANNELS; n++)
+			dOutGain[n][i] = bUsed && n == c ? 1.0 / layout.nVoices : 0.0;
+
+		for (int s = 0; s < MOD_PHASER_STAGES; s++)
+			dAllpass[s][i] = 0.0;
+
+		dLast[i] = 0.0;
+	}
+
+	nLayoutType = nType;
+	nLayoutChannels = nChannels;
+	nRamp = 0;
+}
+
+//lfo values for the next MOD_CONTROL_RATE frames, for the phaser turned into allpass coefficient ramps
+void ModEffects::NextRamp()
+{
+	lfo.Next(MOD_CONTROL_RATE, dLfo, dLfoStep);
+
+	if (nType == MOD_PHASER)
+	{
+		for (int i = 0; i < nLanes; i++)
+		{
+			double dCoeffs[2];
+
+			for (int e = 0; e < 2; e++)
+			{
+				double dMod = dLfo[i] + e * dLfoStep[i] * MOD_CONTROL_RATE;
+				double dFrequency = MOD_PHASER_LOW * pow(2.0, MOD_PHASER_OCTAVES * dDepth * 0.5 * (1.0 + dMod));
+				double t = tan(PI * dFrequency / nSampleRate);
+
+				dCoeffs[e] = (t - 1.0) / (t + 1.0);
+			}
+
+			dCoeff[i] = dCoeffs[0];
+			dCoeffStep[i] = (dCoeffs[1] - dCoeffs[0]) / MOD_CONTROL_RATE;
+		}
+	}
+
+	nRamp = MOD_CONTROL_RATE;
+}
+
+//every lane is a voice reading its channel's line at base + range * (1 + lfo), the flanger feeds its output back
+template <class V>
+void ModEffects::RenderDelay(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels)
+{
+	typedef typename V::T T;
+
+	T base = V::Set(dBase);
+	T range = V::Set(0.5 * dRange * dDepth);
+	T one = V::Set(1.0);
+	double dFeed = nType == MOD_FLANGER ? dFeedback : 0.0;
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nStride;
+		T sum[MOD_CHANNELS];
+
+		if (nRamp == 0)
+			NextRamp();
+
+		nRamp--;
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			sum[c] = V::Set(0.0);
+
+		for (int i = 0; i < nLanes; i += V::N)
+		{
+			T mod = V::Load(dLfo + i);
+
+			V::Store(dLfo + i, V::Add(mod, V::Load(dLfoStep + i)));
+
+			T tap = line.Read<V>(V::Load(dChannel + i), V::Add(base, V::Mul(range, V::Add(one, mod))));
+
+			for (unsigned int c = 0; c < nChannels; c++)
+				sum[c] = V::Add(sum[c], V::Mul(tap, V::Load(dOutGain[c] + i)));
+		}
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			double dWet = V::Sum(sum[c]);
+
+			line.Write(c, pFrame[c] + dFeed * dWet);
+			pFrame[c] += dMix * (dWet - pFrame[c]);
+		}
+
+		line.Advance();
+	}
+
+	V::End();
+}
+
+//first order allpasses in series per channel, their notches move with the coefficient
+template <class V>
+void ModEffects::RenderPhaser(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels)
+{
+	typedef typename V::T T;
+
+	T feed = V::Set(dFeedback);
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nStride;
+		T sum[MOD_CHANNELS];
+
+		if (nRamp == 0)
+			NextRamp();
+
+		nRamp--;
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			sum[c] = V::Set(0.0);
+
+		for (int i = 0; i < nLanes; i++)
+			dInput[i] = pFrame[(int)dChannel[i]];
+
+		for (int i = 0; i < nLanes; i += V::N)
+		{
+			T a = V::Load(dCoeff + i);
+
+			V::Store(dCoeff + i, V::Add(a, V::Load(dCoeffStep + i)));
+
+			T x = V::Add(V::Load(dInput + i), V::Mul(feed, V::Load(dLast + i)));
+
+			for (int s = 0; s < MOD_PHASER_STAGES; s++)
+			{
+				T state = V::Load(dAllpass[s] + i);
+				T y = V::Add(V::Mul(a, x), state);
+
+				V::Store(dAllpass[s] + i, V::Sub(x, V::Mul(a, y)));
+				x = y;
+			}
+
+			V::Store(dLast + i, x);
+
+			for (unsigned int c = 0; c < nChannels; c++)
+				sum[c] = V::Add(sum[c], V::Mul(x, V::Load(dOutGain[c] + i)));
+		}
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			pFrame[c] += dMix * (V::Sum(sum[c]) - pFrame[c]);
+	}
+
+	V::End();
+}
+
+struct modKernels
+{
+	static const ModEffects::Kernel delayKernels[SIMD_AVX512 + 1];
+	static const ModEffects::Kernel phaserKernels[SIMD_AVX512 + 1];
+};
+
+const ModEffects::Kernel modKernels::delayKernels[SIMD_AVX512 + 1] =
+{
+	&ModEffects::RenderDelay<VecScalar>,
+	&ModEffects::RenderDelay<VecSSE2>,
+	&ModEffects::RenderDelay<VecAVX2>,
+	&ModEffects::RenderDelay<VecAVX512>,
+};
+
+const ModEffects::Kernel modKernels::phaserKernels[SIMD_AVX512 + 1] =
+{
+	&ModEffects::RenderPhaser<VecScalar>,
+	&ModEffects::RenderPhaser<VecSSE2>,
+	&ModEffects::RenderPhaser<VecAVX2>,
+	&ModEffects::RenderPhaser<VecAVX512>,
+};
+
+void ModEffects::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	if (nType == MOD_OFF || dMix <= 0.0 || line.GetLength() == 0)
+		return;
+
+	unsigned int nStride = nChannels;
+
+	if (nChannels > MOD_CHANNELS)
+		nChannels = MOD_CHANNELS;
+
+	if (nType != nLayoutType || nChannels != nLayoutChannels)
+		SetLayout(nChannels);
+
+	lfo.SetRate(dRate);
+
+	//the narrowest vectors that hold every lane, wider ones would only carry empty lanes
+	int nSet = SIMDInstructionSet();
+
+	while (nSet > SIMD_SSE2 && SIMDWidth(nSet - 1) >= nLanes)
+		nSet--;
+
+	Kernel pKernel = nType == MOD_PHASER ? modKernels::phaserKernels[nSet] : modKernels::delayKernels[nSet];
+
+	(this->*pKernel)(pBlock, nFrames, nStride, nChannels);
+}
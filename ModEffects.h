@@ -0,0 +1,89 @@
+#pragma once
+
+#include "DelayLine.h"
+#include "LFO.h"
+
+#define MOD_LANES LFO_LANES //voices of both channels side by side, one lfo lane each
+#define MOD_CHANNELS 2
+#define MOD_CONTROL_RATE 32 //frames between lfo evaluations, the values are ramped in between
+#define MOD_MAX_DELAY 40.0 //ms
+#define MOD_PHASER_STAGES 6
+#define MOD_PHASER_LOW 200.0 //Hz, lowest allpass frequency of the sweep
+#define MOD_PHASER_OCTAVES 5.0 //width of the sweep at full depth
+
+//effects
+#define MOD_OFF 0
+#define MOD_CHORUS 1
+#define MOD_ENSEMBLE 2
+#define MOD_FLANGER 3
+#define MOD_PHASER 4
+
+//Chorus, ensemble, flanger and phaser for the summed voices.
+//Chorus, ensemble and flanger are voices reading one DelayLine at lfo modulated delays,
+//the phaser sweeps a cascade of allpasses. The voices of both channels are lanes of the same vectors,
+//so a stereo frame is one SIMD pass whatever the effect.
+class ModEffects
+{
+public:
+	ModEffects();
+	~ModEffects();
+
+	void SetSampleRate(unsigned int nSampleRate); //allocates the delay line
+	void SetType(int nType);
+	void SetRate(double dRate); //Hz
+	void SetDepth(double dDepth); //0 to 1 of the effect's sweep
+	void SetFeedback(double dFeedback); //-0.95 to 0.95, flanger and phaser only
+	void SetMix(double dMix); //0 dry to 1 wet
+
+	int GetType();
+	double GetRate();
+	double GetDepth();
+	double GetFeedback();
+	double GetMix();
+
+	void Reset();
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place, channels past MOD_CHANNELS stay dry
+
+	typedef void (ModEffects::*Kernel)(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels);
+
+private:
+	friend struct modKernels;
+
+	DelayLine line;
+	ControlLFO lfo;
+
+	unsigned int nSampleRate = 44100;
+	int nType = MOD_OFF;
+	double dRate = 0.8;
+	double dDepth = 0.5;
+	double dFeedback = 0.0;
+	double dMix = 0.0;
+
+	//voice layout of the current effect and channel count
+	int nLayoutType = -1;
+	unsigned int nLayoutChannels = 0;
+	int nLanes = 0;
+	double dBase = 0.0; //shortest delay in samples
+	double dRange = 0.0; //delay range in samples at full depth
+	double dChannel[MOD_LANES]; //channel each lane reads
+	double dOutGain[MOD_CHANNELS][MOD_LANES];
+
+	//lfo ramps, in lanes
+	unsigned int nRamp = 0; //frames left in the current ramp
+	double dLfo[MOD_LANES];
+	double dLfoStep[MOD_LANES];
+	double dCoeff[MOD_LANES]; //phaser allpass coefficient, ramped like the lfo
+	double dCoeffStep[MOD_LANES];
+
+	double dAllpass[MOD_PHASER_STAGES][MOD_LANES];
+	double dLast[MOD_LANES]; //phaser output for the feedback
+	double dInput[MOD_LANES];
+
+	void SetLayout(unsigned int nChannels);
+	void NextRamp();
+
+	template <class V>
+	void RenderDelay(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels);
+	template <class V>
+	void RenderPhaser(double *pBlock, unsigned int nFrames, unsigned int nStride, unsigned int nChannels);
+};
@@ -0,0 +1,80 @@
+#include "Noise.h"
+
+#include <atomic>
+#include <cstring>
+
+NoiseGenerator::NoiseGenerator()
+{
+	Seed(NextSeed());
+}
+
+NoiseGenerator::~NoiseGenerator()
+{
+}
+
+void NoiseGenerator::Seed(uint64_t nSeed)
+{
+	nState = nSeed ? nSeed : 1; //an all zero state never leaves zero
+
+	dPink[0] = dPink[1] = dPink[2] = 0.0;
+	dBrown = 0.0;
+}
+
+double NoiseGenerator::White()
+{
+	nState ^= nState << 13;
+	nState ^= nState >> 7;
+	nState ^= nState << 17;
+
+	//top 52 bits as the mantissa of a double in [1, 2)
+	uint64_t nBits = (nState >> 12) | 0x3FF0000000000000ULL;
+	double d;
+	memcpy(&d, &nBits, sizeof(d));
+
+	return 2.0 * d - 3.0;
+}
+
+double NoiseGenerator::Pink()
+{
+	double dWhite = White();
+
+	dPink[0] = NOISE_PINK_POLE0 * dPink[0] + NOISE_PINK_GAIN0 * dWhite;
+	dPink[1] = NOISE_PINK_POLE1 * dPink[1] + NOISE_PINK_GAIN1 * dWhite;
+	dPink[2] = NOISE_PINK_POLE2 * dPink[2] + NOISE_PINK_GAIN2 * dWhite;
+
+	return NOISE_PINK_SCALE * (dPink[0] + dPink[1] + dPink[2] + NOISE_PINK_DIRECT * dWhite);
+}
+
+double NoiseGenerator::Brown()
+{
+	dBrown = NOISE_BROWN_LEAK * dBrown + NOISE_BROWN_STEP * White();
+
+	return dBrown;
+}
+
+double NoiseGenerator::Play(int nColor)
+{
+	switch (nColor)
+	{
+	case NOISE_PINK:
+		return Pink();
+	case NOISE_BROWN:
+		return Brown();
+	default:
+		return White();
+	}
+}
+
+//splitmix64 of a shared counter
+uint64_t NoiseGenerator::NextSeed()
+{
+	static std::atomic<uint64_t> nCounter(0x9E3779B97F4A7C15ULL);
+
+	uint64_t z = nCounter.fetch_add(0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	z ^= z >> 31;
+
+	return z ? z : 1;
+}
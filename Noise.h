@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#define NOISE_WHITE 0
+#define NOISE_PINK 1 //-3 dB per octave
+#define NOISE_BROWN 2 //-6 dB per octave
+
+//pink noise, three one pole lowpasses summed (Paul Kellet's economy filter)
+#define NOISE_PINK_POLE0 0.99765
+#define NOISE_PINK_POLE1 0.96300
+#define NOISE_PINK_POLE2 0.57000
+#define NOISE_PINK_GAIN0 0.0990460
+#define NOISE_PINK_GAIN1 0.2965164
+#define NOISE_PINK_GAIN2 1.0526913
+#define NOISE_PINK_DIRECT 0.1848
+#define NOISE_PINK_SCALE 0.25 //brings the level close to white noise
+
+//brown noise, leaky integrator with its corner around 35 Hz at 44.1 kHz
+#define NOISE_BROWN_LEAK 0.995
+#define NOISE_BROWN_STEP 0.1
+
+//xorshift64 generator with private state, safe to run one per voice on the audio thread
+class NoiseGenerator
+{
+public:
+	NoiseGenerator();
+	~NoiseGenerator();
+
+	void Seed(uint64_t nSeed);
+
+	double White(); //uniform in [-1, 1)
+	double Pink();
+	double Brown();
+	double Play(int nColor);
+
+	static uint64_t NextSeed(); //different for every call, keeps generators uncorrelated
+
+private:
+	uint64_t nState;
+	double dPink[3];
+	double dBrown;
+};
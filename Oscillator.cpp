@@ -1,9 +1,12 @@
 #include "Oscillator.h"
+#include "Wavetable.h"
+#include "OscillatorBank.h"
 
 #include <cmath>
 
 Oscillator::Oscillator()
 {
+	pWavetable = &Wavetable::Get(parameters.nWave);
 }
 
 Oscillator::~Oscillator()
@@ -13,6 +16,8 @@ Oscillator::~Oscillator()
 void Oscillator::SetParameters(oscParams p)
 {
 	parameters = p;
+	pWavetable = &Wavetable::Get(parameters.nWave);
+	UpdateTuning();
 }
 
 void Oscillator::SetVolume(double dVolume)
@@ -38,6 +43,28 @@ void Oscillator::SetChannelVolume(double dChannels[4])
 void Oscillator::SetWave(uint8_t nWave)
 {
 	parameters.nWave = nWave;
+	pWavetable = &Wavetable::Get(nWave);
+}
+
+void Oscillator::SetEngine(uint8_t nEngine)
+{
+	parameters.nEngine = nEngine;
+}
+
+//duty cycle of the square wave, 0.5 is a plain square
+void Oscillator::SetPulseWidth(double dPulseWidth)
+{
+	if (dPulseWidth < 0.01)
+		dPulseWidth = 0.01;
+	else if (dPulseWidth > 0.99)
+		dPulseWidth = 0.99;
+
+	parameters.dPulseWidth = dPulseWidth;
+}
+
+void Oscillator::SetSync(bool bSync)
+{
+	parameters.bSync = bSync;
 }
 
 void Oscillator::SetFrequency(double dFreq)
@@ -48,6 +75,7 @@ void Oscillator::SetFrequency(double dFreq)
 void Oscillator::SetFineTune(int nCents)
 {
 	parameters.nFineTune = nCents;
+	UpdateTuning();
 }
 
 void Oscillator::SetDrone(bool bDrone)
@@ -101,11 +129,46 @@ void Oscillator::SetOctave(int8_t nOctaveMod)
 	parameters.nOctaveMod = nOctaveMod;
 }
 
+void Oscillator::SetFreeRun(bool bFreeRun)
+{
+	parameters.bFreeRun = bFreeRun;
+}
+
+void Oscillator::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+	UpdateTuning();
+}
+
+//called on note on, restarts the waveform unless the oscillator is free running
+void Oscillator::ResetPhase(oscPhase &phase)
+{
+	if (!parameters.bFreeRun)
+		phase.dPhase = 0.0;
+}
+
+void Oscillator::ResetVoice(OscillatorBank &bank, int nVoice)
+{
+	if (!parameters.bFreeRun)
+		bank.ResetVoice(nVoice);
+}
+
+void Oscillator::UpdateTuning()
+{
+	dFineRatio = pow(2.0, parameters.nFineTune / 1200.0);
+	nVersion++;
+}
+
 double Oscillator::GetVolume()
 {
 	return parameters.dVolume;
 }
 
+double Oscillator::GetAmplitude()
+{
+	return parameters.dAmplitude;
+}
+
 double Oscillator::GetChannelVolume(uint8_t nChannel)
 {
 	if (nChannel < 0 || nChannel > 3)
@@ -139,46 +202,165 @@ int8_t Oscillator::GetOctaveMod()
 	return parameters.nOctaveMod;
 }
 
-double Oscillator::Play(double dFreq, double dTime, int8_t nChannel)
+bool Oscillator::GetFreeRun()
 {
-	double dOutput = 0.0;
-	double dHalfStep = dFreq * pow(2, 1 / 12.0) - dFreq;
+	return parameters.bFreeRun;
+}
 
-	dOutput = sin((dFreq + dHalfStep * parameters.nFineTune/100.0) * PI_R * dTime + parameters.dFM);
+uint8_t Oscillator::GetEngine()
+{
+	return parameters.nEngine;
+}
 
-	switch (parameters.nWave)
+double Oscillator::GetPulseWidth()
+{
+	return parameters.dPulseWidth;
+}
+
+bool Oscillator::GetSync()
+{
+	return parameters.bSync;
+}
+
+//residual between a 2 sample polynomial band limited step and an ideal unit step, dX is the distance to the step in samples
+static double PolyBlep(double dX)
+{
+	if (dX <= -1.0 || dX >= 1.0)
+		return 0.0;
+
+	if (dX < 0.0)
+		return 0.5 * (dX + 1.0) * (dX + 1.0);
+	else
+		return -0.5 * (1.0 - dX) * (1.0 - dX);
+}
+
+//residual of the integrated step, corrects a unit change of slope per sample
+static double PolyBlamp(double dX)
+{
+	if (dX <= -1.0 || dX >= 1.0)
+		return 0.0;
+
+	if (dX < 0.0)
+		return (dX + 1.0) * (dX + 1.0) * (dX + 1.0) / 6.0;
+	else
+		return (1.0 - dX) * (1.0 - dX) * (1.0 - dX) / 6.0;
+}
+
+//distance in samples from dPhase to the nearest occurrence of dEdge
+static double EdgeDistance(double dPhase, double dEdge, double dIncrement)
+{
+	double d = dPhase - dEdge;
+	d -= floor(d + 0.5);
+
+	return d / dIncrement;
+}
+
+double Oscillator::Play(double dFreq, oscPhase &phase, int8_t nChannel)
+{
+	UpdateIncrement(phase, dFreq);
+
+	double dOutput = Render(phase);
+
+	Advance(phase);
+
+	return ApplyGain(dOutput, nChannel);
+}
+
+//hard sync, restarts the phase whenever master wraps. master has to be played before this oscillator in the same frame
+double Oscillator::Play(double dFreq, oscPhase &phase, const oscPhase &master, int8_t nChannel)
+{
+	UpdateIncrement(phase, dFreq);
+
+	double dOutput = Render(phase);
+	bool bBlep = parameters.nEngine == OSC_BLEP;
+
+	//second half of the previous frame's sync step
+	if (phase.dSyncStep != 0.0)
 	{
-	case WAVE_SINE:
-		
-		break;
-	case WAVE_SQUARE:
+		dOutput += phase.dSyncStep * PolyBlep(phase.dSyncDistance);
+		phase.dSyncStep = 0.0;
+	}
 
-		if (dOutput > 0.0)
-			dOutput = 1.0;
-		else
-			dOutput = -1.0;
+	//master's last advance wrapped, so its reset falls between this frame and the next
+	if (master.dIncrement > 0.0 && master.dPhase < master.dIncrement)
+	{
+		double dT = 1.0 - master.dPhase / master.dIncrement; //fraction of a sample until the reset
+		double dSyncPhase = phase.dPhase + dT * phase.dIncrement;
+		dSyncPhase -= floor(dSyncPhase);
 
-		break;
-	case WAVE_SAW:
+		if (bBlep && parameters.nWave < WAVE_NOISE)
+		{
+			double dStep = PlayNaive(0.0) - PlayNaive(dSyncPhase);
+
+			//after the reset PlayBlep already corrects its own step at phase 0, only the difference is left for the second half
+			double dWrapStep = (parameters.nWave == WAVE_SAW || parameters.nWave == WAVE_SQUARE) ? 2.0 : 0.0;
+
+			dOutput += dStep * PolyBlep(-dT);
+			phase.dSyncStep = dStep - dWrapStep;
+			phase.dSyncDistance = 1.0 - dT;
+		}
+
+		phase.dPhase = (1.0 - dT) * phase.dIncrement;
+	}
+	else
+		Advance(phase);
+
+	return ApplyGain(dOutput, nChannel);
+}
+
+//only recompute the increment when frequency or tuning changed
+void Oscillator::UpdateIncrement(oscPhase &phase, double dFreq)
+{
+	if (phase.dFreq != dFreq || phase.nVersion != nVersion)
 	{
-		//dOutput = 0.0;
-		//for (double n = 1.0; n < 50.0; n++) //too slow
-		//	dOutput += (sin(n * dFreq * PI_R * dTime)) / n;
+		phase.dIncrement = dFreq * dFineRatio / (double)nSampleRate;
+		phase.dFreq = dFreq;
+		phase.nVersion = nVersion;
+
+		Wavetable::GetMipLevel(phase.dIncrement, phase.nMipLevel, phase.dMipFade);
+	}
+}
 
-		dOutput = -((dFreq + dHalfStep * parameters.nFineTune / 100.0 + parameters.dFM) * PI_R * fmod(dTime, 1.0 / (dFreq + dHalfStep * parameters.nFineTune / 100.0 + parameters.dFM)) - (PI / 2.0)) * 0.5;
+//current sample of the selected engine
+double Oscillator::Render(const oscPhase &phase)
+{
+	//phase modulation is applied on top of the accumulated phase
+	double dPhase = phase.dPhase;
 
-		break;
+	if (parameters.dFM != 0.0)
+	{
+		dPhase += parameters.dFM / PI_R;
+		dPhase -= floor(dPhase);
 	}
-	case WAVE_TRI:
-		dOutput = asin(dOutput);
-		break;
-	case WAVE_NOISE:
-		dOutput = 2.0 * (double(rand()) / double(RAND_MAX)) - 1.0;
-		break;
-	default:
-		dOutput = 0.0;
+
+	if (parameters.nWave >= WAVE_NOISE || parameters.nEngine == OSC_NAIVE)
+		return PlayNaive(dPhase);
+	else if (parameters.nEngine == OSC_BLEP)
+		return PlayBlep(dPhase, phase.dIncrement);
+
+	//pulse widths other than 50% are the difference of two saws
+	if (parameters.nWave == WAVE_SQUARE && parameters.dPulseWidth != 0.5)
+	{
+		const Wavetable &saw = Wavetable::Get(WAVE_SAW);
+		double dShifted = dPhase - parameters.dPulseWidth;
+		dShifted -= floor(dShifted);
+
+		return saw.Lookup(dPhase, phase.nMipLevel, phase.dMipFade) - saw.Lookup(dShifted, phase.nMipLevel, phase.dMipFade) + 2.0 * parameters.dPulseWidth - 1.0;
 	}
 
+	return pWavetable->Lookup(dPhase, phase.nMipLevel, phase.dMipFade);
+}
+
+void Oscillator::Advance(oscPhase &phase)
+{
+	phase.dPhase += phase.dIncrement;
+
+	if (phase.dPhase >= 1.0)
+		phase.dPhase -= floor(phase.dPhase);
+}
+
+double Oscillator::ApplyGain(double dOutput, int8_t nChannel)
+{
 	if (nChannel > 3)
 		nChannel = -1;
 
@@ -187,3 +369,88 @@ double Oscillator::Play(double dFreq, double dTime, int8_t nChannel)
 	else
 		return dOutput * parameters.dChannelVolume[nChannel] * parameters.dAmplitude;
 }
+
+//waveforms computed directly from the phase
+double Oscillator::PlayNaive(double dPhase)
+{
+	switch (parameters.nWave)
+	{
+	case WAVE_SINE:
+		return sin(PI_R * dPhase);
+	case WAVE_SQUARE:
+		return dPhase < parameters.dPulseWidth ? 1.0 : -1.0;
+	case WAVE_SAW:
+		return 1.0 - 2.0 * dPhase;
+	case WAVE_TRI:
+		if (dPhase < 0.25)
+			return 4.0 * dPhase;
+		else if (dPhase < 0.75)
+			return 2.0 - 4.0 * dPhase;
+		else
+			return 4.0 * dPhase - 4.0;
+	case WAVE_NOISE:
+		return noise.White();
+	case WAVE_PINK:
+		return noise.Pink();
+	case WAVE_BROWN:
+		return noise.Brown();
+	default:
+		return 0.0;
+	}
+}
+
+//naive waveforms with polynomial corrections around every step (BLEP) and corner (BLAMP)
+double Oscillator::PlayBlep(double dPhase, double dIncrement)
+{
+	double dOutput = PlayNaive(dPhase);
+
+	if (dIncrement <= 0.0)
+		return dOutput;
+
+	switch (parameters.nWave)
+	{
+	case WAVE_SQUARE:
+		dOutput += 2.0 * PolyBlep(EdgeDistance(dPhase, 0.0, dIncrement));
+		dOutput -= 2.0 * PolyBlep(EdgeDistance(dPhase, parameters.dPulseWidth, dIncrement));
+		break;
+	case WAVE_SAW:
+		dOutput += 2.0 * PolyBlep(EdgeDistance(dPhase, 0.0, dIncrement));
+		break;
+	case WAVE_TRI:
+		//slope flips between +4 and -4 per cycle at the peaks
+		dOutput -= 8.0 * dIncrement * PolyBlamp(EdgeDistance(dPhase, 0.25, dIncrement));
+		dOutput += 8.0 * dIncrement * PolyBlamp(EdgeDistance(dPhase, 0.75, dIncrement));
+		break;
+	}
+
+	return dOutput;
+}
+
+double Oscillator::Play(double dFreq, int8_t nChannel)
+{
+	return Play(dFreq, freePhase, nChannel);
+}
+
+//renders the voices of bank with this oscillator's settings, several voices per instruction
+double Oscillator::Play(OscillatorBank &bank, const double *pGains, const bankMaster *pMaster, int8_t nChannel)
+{
+	bankParams params;
+	params.nWave = parameters.nWave;
+	params.nEngine = parameters.nEngine;
+	params.dPulseWidth = parameters.dPulseWidth;
+	params.dPhaseOffset = parameters.dFM / PI_R;
+	params.pTable = pWavetable->GetData();
+	params.pSawTable = Wavetable::Get(WAVE_SAW).GetData();
+
+	return ApplyGain(bank.Play(params, pGains, pMaster), nChannel);
+}
+
+void Oscillator::SetVoice(OscillatorBank &bank, int nVoice, double dFreq)
+{
+	bank.SetVoice(nVoice, dFreq * dFineRatio / (double)nSampleRate);
+}
+
+const oscPhase &Oscillator::GetPhase()
+{
+	return freePhase;
+}
@@ -3,14 +3,22 @@
 #include <cstdint>
 #include <string>
 
-#define PI 3.14159
-#define PI_R PI * 2
+#include "Noise.h"
+
+class Wavetable;
+class OscillatorBank;
+struct bankMaster;
+
+#define PI 3.14159265358979
+#define PI_R (PI * 2)
 
 #define WAVE_SINE 1
 #define WAVE_SQUARE 2
 #define WAVE_SAW 3
 #define WAVE_TRI 4
-#define WAVE_NOISE 5
+#define WAVE_NOISE 5 //noise colors from here on have no phase
+#define WAVE_PINK 6
+#define WAVE_BROWN 7
 
 //stereo channel definitions
 #define CH_LEFT 0
@@ -18,9 +26,15 @@
 
 #define CH_MONO -1
 
+//oscillator engines
+#define OSC_NAIVE 0 //waveforms computed directly from the phase, aliases at high pitch
+#define OSC_TABLE 1 //band limited mipmapped wavetables
+#define OSC_BLEP 2 //naive waveforms with PolyBLEP/PolyBLAMP corrections, no table memory
+
 struct oscParams
 {
 	std::uint8_t nWave = WAVE_SINE;
+	std::uint8_t nEngine = OSC_TABLE;
 	double dVolume = 1.0;
 	double dChannelVolume[4] = { 0.5, 0.5, 0.0, 0.0 };
 	int8_t nFineTune = 0; // in cents
@@ -33,6 +47,22 @@ struct oscParams
 	double dAmplitude = dVolume;
 
 	bool bLFO = false;
+	bool bFreeRun = false; //keep the voice phase running across notes instead of resetting it
+	double dPulseWidth = 0.5; //duty cycle of WAVE_SQUARE
+	bool bSync = false; //hard sync to a master oscillator
+};
+
+//per voice oscillator state, the phase runs in cycles from 0.0 to 1.0
+struct oscPhase
+{
+	double dPhase = 0.0;
+	double dIncrement = 0.0;
+	double dFreq = -1.0; //base frequency the increment was computed for
+	uint32_t nVersion = 0; //tuning version the increment was computed for
+	int nMipLevel = 0; //wavetable level and crossfade for the current increment
+	double dMipFade = 0.0;
+	double dSyncStep = 0.0; //pending second half of a hard sync correction
+	double dSyncDistance = 0.0;
 };
 
 class Oscillator
@@ -46,6 +76,9 @@ public:
 	void SetChannelVolume(uint8_t nChannel, double dVolume);
 	void SetChannelVolume(double dChannels[4]);
 	void SetWave(uint8_t nWave);
+	void SetEngine(uint8_t nEngine);
+	void SetPulseWidth(double dPulseWidth);
+	void SetSync(bool bSync);
 	void SetFrequency(double dFreq);
 	void SetFineTune(int nCents);
 	void SetDrone(bool bDrone);
@@ -56,17 +89,46 @@ public:
 	void ResetAM();
 	void SetLFO(bool bLFO);
 	void SetOctave(int8_t nOctaveMod); //-3 to +3
+	void SetFreeRun(bool bFreeRun);
+	void SetSampleRate(unsigned int nSampleRate);
+	void ResetPhase(oscPhase &phase);
+	void ResetVoice(OscillatorBank &bank, int nVoice);
 	
 	double GetVolume();
+	double GetAmplitude(); //volume including amplitude modulation
 	double GetChannelVolume(uint8_t nChannel);
 	double GetFrequency();
 	int8_t GetFineTune();
 	bool GetDrone();
 	bool IsLFO();
 	int8_t GetOctaveMod();
+	bool GetFreeRun();
+	uint8_t GetEngine();
+	double GetPulseWidth();
+	bool GetSync();
+	const oscPhase &GetPhase(); //free running phase, master for hard synced drones
 
-	double Play(double dFreq, double dTime, int8_t nChannel = CH_MONO);
+	double Play(double dFreq, oscPhase &phase, int8_t nChannel = CH_MONO); //returns the current sample and advances the phase
+	double Play(double dFreq, oscPhase &phase, const oscPhase &master, int8_t nChannel = CH_MONO); //hard synced to master
+	double Play(double dFreq, int8_t nChannel = CH_MONO); //plays from the oscillator's own phase (drones, LFOs, modulators)
+	double Play(OscillatorBank &bank, const double *pGains, const bankMaster *pMaster = nullptr, int8_t nChannel = CH_MONO); //one frame of every voice in bank, mixed by pGains
+	void SetVoice(OscillatorBank &bank, int nVoice, double dFreq); //tunes one voice of a bank
 
 private:
 	oscParams parameters;
+	oscPhase freePhase;
+	NoiseGenerator noise;
+	const Wavetable *pWavetable; //band limited tables of the current wave
+
+	unsigned int nSampleRate = 44100;
+	double dFineRatio = 1.0; //2^(cents/1200), cached when the fine tune changes
+	uint32_t nVersion = 1; //bumped whenever the phase increments have to be recomputed
+
+	void UpdateTuning();
+	void UpdateIncrement(oscPhase &phase, double dFreq);
+	void Advance(oscPhase &phase);
+	double Render(const oscPhase &phase);
+	double ApplyGain(double dOutput, int8_t nChannel);
+	double PlayNaive(double dPhase);
+	double PlayBlep(double dPhase, double dIncrement);
 };
@@ -0,0 +1,525 @@
+#include "OscillatorBank.h"
+#include "Oscillator.h"
+#include "Wavetable.h"
+#include "Noise.h"
+#include "SIMD.h"
+
+//kernel variant for the table engine when a wave renders pulse widths other than 50% from two saws
+#define BANK_PULSE 3
+#define BANK_ENGINES 4
+
+//sin(2 pi q) for q in [0, 1), odd polynomial on the range folded to [-pi/2, pi/2], error below 1e-9
+template <class V>
+static typename V::T Sine(typename V::T q)
+{
+	typedef typename V::T T;
+
+	T x = V::Sub(q, V::Set(0.5)); //sin(2 pi q) = -sin(2 pi x)
+	x = V::Select(V::Less(V::Set(0.25), x), V::Sub(V::Set(0.5), x), x);
+	x = V::Select(V::Less(x, V::Set(-0.25)), V::Sub(V::Set(-0.5), x), x);
+
+	T y = V::Mul(x, V::Set(-PI_R));
+	T y2 = V::Mul(y, y);
+
+	T s = V::Set(-1.0 / 6227020800.0);
+	s = V::Add(V::Mul(s, y2), V::Set(1.0 / 39916800.0));
+	s = V::Sub(V::Mul(s, y2), V::Set(1.0 / 362880.0));
+	s = V::Add(V::Mul(s, y2), V::Set(1.0 / 5040.0));
+	s = V::Sub(V::Mul(s, y2), V::Set(1.0 / 120.0));
+	s = V::Add(V::Mul(s, y2), V::Set(1.0 / 6.0));
+	s = V::Sub(V::Set(1.0), V::Mul(s, y2));
+
+	return V::Mul(s, y);
+}
+
+//same residuals as the scalar oscillator, written without branches
+template <class V>
+static typename V::T PolyBlep(typename V::T x)
+{
+	typedef typename V::T T;
+
+	T a = V::Max(V::Sub(V::Set(1.0), V::Abs(x)), V::Set(0.0));
+	T s = V::Select(V::Less(x, V::Set(0.0)), V::Set(0.5), V::Set(-0.5));
+
+	return V::Mul(s, V::Mul(a, a));
+}
+
+template <class V>
+static typename V::T PolyBlamp(typename V::T x)
+{
+	typedef typename V::T T;
+
+	T a = V::Max(V::Sub(V::Set(1.0), V::Abs(x)), V::Set(0.0));
+
+	return V::Mul(V::Set(1.0 / 6.0), V::Mul(a, V::Mul(a, a)));
+}
+
+template <class V>
+static typename V::T EdgeDistance(typename V::T q, double dEdge, typename V::T invInc)
+{
+	typedef typename V::T T;
+
+	T d = V::Sub(q, V::Set(dEdge));
+	d = V::Sub(d, V::Floor(V::Add(d, V::Set(0.5))));
+
+	return V::Mul(d, invInc);
+}
+
+//interpolated lookup in two mip levels per lane, crossfaded like Wavetable::Lookup
+template <class V>
+static typename V::T Table(const float *pData, const int32_t *pLevel, const int32_t *pNext, typename V::T fade, typename V::T q)
+{
+	typedef typename V::T T;
+
+	T idx = V::Mul(q, V::Set(WT_SIZE));
+	T i = V::Min(V::Floor(idx), V::Set(WT_SIZE - 1));
+	T frac = V::Sub(idx, i);
+
+	T a0, a1, b0, b1;
+	V::Gather(pData, pLevel, i, a0, a1);
+	V::Gather(pData, pNext, i, b0, b1);
+
+	T a = V::Add(a0, V::Mul(frac, V::Sub(a1, a0)));
+	T b = V::Add(b0, V::Mul(frac, V::Sub(b1, b0)));
+
+	return V::Add(a, V::Mul(fade, V::Sub(b, a)));
+}
+
+//Waveform kernels. Naive() is the shape computed from the phase, Blep() adds the polynomial residuals
+//around its steps and corners. bTable selects the mipmapped tables for OSC_TABLE, bPulse the two saw
+//pulse for widths other than 50%, nWrapStep is the step at phase 0 that Blep() already corrects.
+struct WaveSine
+{
+	enum { bTable = 0, bPulse = 0, nWrapStep = 0 };
+
+	template <class V>
+	static typename V::T Naive(const bankParams &params, typename V::T q)
+	{
+		return Sine<V>(q);
+	}
+
+	template <class V>
+	static typename V::T Blep(const bankParams &params, typename V::T q, typename V::T inc, typename V::T invInc)
+	{
+		return Sine<V>(q);
+	}
+};
+
+struct WaveSquare
+{
+	enum { bTable = 1, bPulse = 1, nWrapStep = 2 };
+
+	template <class V>
+	static typename V::T Naive(const bankParams &params, typename V::T q)
+	{
+		return V::Select(V::Less(q, V::Set(params.dPulseWidth)), V::Set(1.0), V::Set(-1.0));
+	}
+
+	template <class V>
+	static typename V::T Blep(const bankParams &params, typename V::T q, typename V::T inc, typename V::T invInc)
+	{
+		typename V::T v = Naive<V>(params, q);
+
+		v = V::Add(v, V::Mul(V::Set(2.0), PolyBlep<V>(EdgeDistance<V>(q, 0.0, invInc))));
+
+		return V::Sub(v, V::Mul(V::Set(2.0), PolyBlep<V>(EdgeDistance<V>(q, params.dPulseWidth, invInc))));
+	}
+};
+
+struct WaveSaw
+{
+	enum { bTable = 1, bPulse = 0, nWrapStep = 2 };
+
+	template <class V>
+	static typename V::T Naive(const bankParams &params, typename V::T q)
+	{
+		return V::Sub(V::Set(1.0), V::Mul(V::Set(2.0), q));
+	}
+
+	template <class V>
+	static typename V::T Blep(const bankParams &params, typename V::T q, typename V::T inc, typename V::T invInc)
+	{
+		return V::Add(Naive<V>(params, q), V::Mul(V::Set(2.0), PolyBlep<V>(EdgeDistance<V>(q, 0.0, invInc))));
+	}
+};
+
+struct WaveTri
+{
+	enum { bTable = 1, bPulse = 0, nWrapStep = 0 };
+
+	//peak at a quarter cycle, 1 - 4|r - 0.5| with r the phase shifted by a quarter
+	template <class V>
+	static typename V::T Naive(const bankParams &params, typename V::T q)
+	{
+		typename V::T r = V::Add(q, V::Set(0.25));
+		r = V::Sub(r, V::Select(V::Less(r, V::Set(1.0)), V::Set(0.0), V::Set(1.0)));
+
+		return V::Sub(V::Set(1.0), V::Mul(V::Set(4.0), V::Abs(V::Sub(r, V::Set(0.5)))));
+	}
+
+	//slope flips between +4 and -4 per cycle at the peaks
+	template <class V>
+	static typename V::T Blep(const bankParams &params, typename V::T q, typename V::T inc, typename V::T invInc)
+	{
+		typename V::T slope = V::Mul(V::Set(8.0), inc);
+		typename V::T v = Naive<V>(params, q);
+
+		v = V::Sub(v, V::Mul(slope, PolyBlamp<V>(EdgeDistance<V>(q, 0.25, invInc))));
+
+		return V::Add(v, V::Mul(slope, PolyBlamp<V>(EdgeDistance<V>(q, 0.75, invInc))));
+	}
+};
+
+//every branch below depends on template parameters only and is resolved at compile time
+template <class V, class W, int nEngine, bool bMod, bool bSync>
+double OscillatorBank::Render(int nFirst, int nLast, const bankParams &params, const double *pGains, const bankMaster *pMaster)
+{
+	typedef typename V::T T;
+
+	const T zero = V::Set(0.0);
+	const T one = V::Set(1.0);
+	const T offset = V::Set(params.dPhaseOffset);
+
+	T acc = zero;
+
+	for (int k = nFirst; k < nLast; k += V::N)
+	{
+		T p = V::Load(dPhase + k);
+		T inc = V::Load(dIncrement + k);
+
+		//phase modulation is applied on top of the accumulated phase
+		T q = p;
+
+		if (bMod)
+		{
+			q = V::Add(q, offset);
+			q = V::Sub(q, V::Floor(q));
+		}
+
+		T v;
+
+		if (nEngine == OSC_BLEP)
+		{
+			//a stopped voice has no edges to correct
+			v = V::Select(V::Less(zero, inc), W::template Blep<V>(params, q, inc, V::Load(dInvIncrement + k)), W::template Naive<V>(params, q));
+		}
+		else if (nEngine == BANK_PULSE && W::bPulse)
+		{
+			//pulse as the difference of two band limited saws
+			T fade = V::Load(dFade + k);
+			T shifted = V::Sub(q, V::Set(params.dPulseWidth));
+			shifted = V::Sub(shifted, V::Floor(shifted));
+
+			v = V::Sub(Table<V>(params.pSawTable, nLevelOffset + k, nNextOffset + k, fade, q), Table<V>(params.pSawTable, nLevelOffset + k, nNextOffset + k, fade, shifted));
+			v = V::Add(v, V::Set(2.0 * params.dPulseWidth - 1.0));
+		}
+		else if (nEngine != OSC_NAIVE && W::bTable)
+			v = Table<V>(params.pTable, nLevelOffset + k, nNextOffset + k, V::Load(dFade + k), q);
+		else
+			v = W::template Naive<V>(params, q);
+
+		T next = V::Add(p, inc);
+		next = V::Sub(next, V::Select(V::Less(next, one), zero, one));
+
+		if (bSync)
+		{
+			T mp = pMaster->bBroadcast ? V::Set(*pMaster->pPhase) : V::Load(pMaster->pPhase + k);
+			T mi = pMaster->bBroadcast ? V::Set(*pMaster->pIncrement) : V::Load(pMaster->pIncrement + k);
+
+			//master wrapped during its last advance, the reset falls between this frame and the next
+			typename V::M wrapped = V::And(V::Less(zero, mi), V::Less(mp, mi));
+			T t = V::Sub(one, V::Div(mp, V::Select(wrapped, mi, one)));
+
+			//second half of the previous frame's sync step
+			v = V::Add(v, V::Mul(V::Load(dSyncStep + k), PolyBlep<V>(V::Load(dSyncDistance + k))));
+
+			T step = zero;
+
+			if (nEngine == OSC_BLEP)
+			{
+				T syncPhase = V::Add(p, V::Mul(t, inc));
+				syncPhase = V::Sub(syncPhase, V::Floor(syncPhase));
+
+				T jump = V::Sub(W::template Naive<V>(params, zero), W::template Naive<V>(params, syncPhase));
+				v = V::Add(v, V::Select(wrapped, V::Mul(jump, PolyBlep<V>(V::Sub(zero, t))), zero));
+				step = V::Select(wrapped, V::Sub(jump, V::Set(W::nWrapStep)), zero);
+			}
+
+			V::Store(dSyncStep + k, step);
+			V::Store(dSyncDistance + k, V::Sub(one, t));
+
+			next = V::Select(wrapped, V::Mul(V::Sub(one, t), inc), next);
+		}
+
+		v = V::Mul(v, V::Load(pGains + k));
+		V::Store(dOutput + k, v);
+		V::Store(dPhase + k, next);
+
+		acc = V::Add(acc, v);
+	}
+
+	double dSum = V::Sum(acc);
+	V::End();
+
+	return dSum;
+}
+
+//noise ignores phase, modulation and sync, every voice runs its own xorshift64 generator
+template <class V, int nColor>
+double OscillatorBank::RenderNoise(int nFirst, int nLast, const bankParams &params, const double *pGains, const bankMaster *pMaster)
+{
+	typedef typename V::T T;
+	typedef typename V::I I;
+
+	T acc = V::Set(0.0);
+
+	for (int k = nFirst; k < nLast; k += V::N)
+	{
+		I x = V::LoadI(nNoise + k);
+		x = V::Xor(x, V::template ShiftLeft<13>(x));
+		x = V::Xor(x, V::template ShiftRight<7>(x));
+		x = V::Xor(x, V::template ShiftLeft<17>(x));
+		V::StoreI(nNoise + k, x);
+
+		T v = V::Unit(x);
+
+		if (nColor == NOISE_PINK)
+		{
+			T b0 = V::Add(V::Mul(V::Set(NOISE_PINK_POLE0), V::Load(dPink[0] + k)), V::Mul(V::Set(NOISE_PINK_GAIN0), v));
+			T b1 = V::Add(V::Mul(V::Set(NOISE_PINK_POLE1), V::Load(dPink[1] + k)), V::Mul(V::Set(NOISE_PINK_GAIN1), v));
+			T b2 = V::Add(V::Mul(V::Set(NOISE_PINK_POLE2), V::Load(dPink[2] + k)), V::Mul(V::Set(NOISE_PINK_GAIN2), v));
+			V::Store(dPink[0] + k, b0);
+			V::Store(dPink[1] + k, b1);
+			V::Store(dPink[2] + k, b2);
+
+			v = V::Mul(V::Set(NOISE_PINK_SCALE), V::Add(V::Add(V::Add(b0, b1), b2), V::Mul(V::Set(NOISE_PINK_DIRECT), v)));
+		}
+		else if (nColor == NOISE_BROWN)
+		{
+			v = V::Add(V::Mul(V::Set(NOISE_BROWN_LEAK), V::Load(dBrown + k)), V::Mul(V::Set(NOISE_BROWN_STEP), v));
+			V::Store(dBrown + k, v);
+		}
+
+		v = V::Mul(v, V::Load(pGains + k));
+		V::Store(dOutput + k, v);
+
+		acc = V::Add(acc, v);
+	}
+
+	double dSum = V::Sum(acc);
+	V::End();
+
+	return dSum;
+}
+
+//kernels of one waveform for every instruction set, engine, modulation and sync combination
+struct bankWave
+{
+	uint8_t nWave;
+	bool bPulse;
+	OscillatorBank::Kernel kernels[SIMD_AVX512 + 1][BANK_ENGINES][2][2];
+};
+
+struct bankKernels
+{
+	template <class V, class W, int nEngine>
+	static void RegisterEngine(OscillatorBank::Kernel kernels[2][2])
+	{
+		kernels[0][0] = &OscillatorBank::Render<V, W, nEngine, false, false>;
+		kernels[0][1] = &OscillatorBank::Render<V, W, nEngine, false, true>;
+		kernels[1][0] = &OscillatorBank::Render<V, W, nEngine, true, false>;
+		kernels[1][1] = &OscillatorBank::Render<V, W, nEngine, true, true>;
+	}
+
+	template <class V, class W>
+	static void RegisterSet(OscillatorBank::Kernel kernels[BANK_ENGINES][2][2])
+	{
+		RegisterEngine<V, W, OSC_NAIVE>(kernels[OSC_NAIVE]);
+		RegisterEngine<V, W, OSC_TABLE>(kernels[OSC_TABLE]);
+		RegisterEngine<V, W, OSC_BLEP>(kernels[OSC_BLEP]);
+		RegisterEngine<V, W, BANK_PULSE>(kernels[BANK_PULSE]);
+	}
+
+	template <class V, int nColor>
+	static void RegisterNoiseSet(OscillatorBank::Kernel kernels[BANK_ENGINES][2][2])
+	{
+		for (int e = 0; e < BANK_ENGINES; e++)
+			for (int m = 0; m < 2; m++)
+				for (int s = 0; s < 2; s++)
+					kernels[e][m][s] = &OscillatorBank::RenderNoise<V, nColor>;
+	}
+
+	template <int nColor>
+	static bankWave RegisterNoise(uint8_t nWave)
+	{
+		bankWave wave;
+		wave.nWave = nWave;
+		wave.bPulse = false;
+
+		RegisterNoiseSet<VecScalar, nColor>(wave.kernels[SIMD_SCALAR]);
+		RegisterNoiseSet<VecSSE2, nColor>(wave.kernels[SIMD_SSE2]);
+		RegisterNoiseSet<VecAVX2, nColor>(wave.kernels[SIMD_AVX2]);
+		RegisterNoiseSet<VecAVX512, nColor>(wave.kernels[SIMD_AVX512]);
+
+		return wave;
+	}
+
+	template <class W>
+	static bankWave Register(uint8_t nWave)
+	{
+		bankWave wave;
+		wave.nWave = nWave;
+		wave.bPulse = W::bPulse != 0;
+
+		RegisterSet<VecScalar, W>(wave.kernels[SIMD_SCALAR]);
+		RegisterSet<VecSSE2, W>(wave.kernels[SIMD_SSE2]);
+		RegisterSet<VecAVX2, W>(wave.kernels[SIMD_AVX2]);
+		RegisterSet<VecAVX512, W>(wave.kernels[SIMD_AVX512]);
+
+		return wave;
+	}
+};
+
+//dispatch table, a new waveform needs its kernel struct above and one line here
+static const bankWave waveKernels[] =
+{
+	bankKernels::Register<WaveSine>(WAVE_SINE),
+	bankKernels::Register<WaveSquare>(WAVE_SQUARE),
+	bankKernels::Register<WaveSaw>(WAVE_SAW),
+	bankKernels::Register<WaveTri>(WAVE_TRI),
+	bankKernels::RegisterNoise<NOISE_WHITE>(WAVE_NOISE),
+	bankKernels::RegisterNoise<NOISE_PINK>(WAVE_PINK),
+	bankKernels::RegisterNoise<NOISE_BROWN>(WAVE_BROWN),
+};
+
+OscillatorBank::OscillatorBank()
+{
+	nVoices = 0;
+	nKernelKey = 0xFFFFFFFF;
+	pVectorKernel = nullptr;
+	pScalarKernel = nullptr;
+
+	for (int i = 0; i < BANK_MAX_VOICES; i++)
+	{
+		dPhase[i] = 0.0;
+		dIncrement[i] = 0.0;
+		dInvIncrement[i] = 0.0;
+		dFade[i] = 0.0;
+		dSyncStep[i] = 0.0;
+		dSyncDistance[i] = 0.0;
+		nLevelOffset[i] = 0;
+		nNextOffset[i] = 0;
+		nNoise[i] = NoiseGenerator::NextSeed();
+		dPink[0][i] = dPink[1][i] = dPink[2][i] = 0.0;
+		dBrown[i] = 0.0;
+		dOutput[i] = 0.0;
+	}
+}
+
+OscillatorBank::~OscillatorBank()
+{
+}
+
+void OscillatorBank::SetVoiceCount(int nVoices)
+{
+	if (nVoices < 0)
+		nVoices = 0;
+	else if (nVoices > BANK_MAX_VOICES)
+		nVoices = BANK_MAX_VOICES;
+
+	this->nVoices = nVoices;
+}
+
+int OscillatorBank::GetVoiceCount()
+{
+	return nVoices;
+}
+
+void OscillatorBank::SetVoice(int nVoice, double dIncrement)
+{
+	if (nVoice < 0 || nVoice >= BANK_MAX_VOICES || this->dIncrement[nVoice] == dIncrement)
+		return;
+
+	this->dIncrement[nVoice] = dIncrement;
+	dInvIncrement[nVoice] = dIncrement > 0.0 ? 1.0 / dIncrement : 0.0;
+
+	int nLevel;
+	double dLevelFade;
+	Wavetable::GetMipLevel(dIncrement, nLevel, dLevelFade);
+
+	//the last level has nothing to fade into
+	if (nLevel + 1 >= WT_LEVELS)
+		dLevelFade = 0.0;
+
+	nLevelOffset[nVoice] = nLevel * (WT_SIZE + 1);
+	nNextOffset[nVoice] = (nLevel + 1 < WT_LEVELS ? nLevel + 1 : nLevel) * (WT_SIZE + 1);
+	dFade[nVoice] = dLevelFade;
+}
+
+void OscillatorBank::ResetVoice(int nVoice)
+{
+	if (nVoice < 0 || nVoice >= BANK_MAX_VOICES)
+		return;
+
+	dPhase[nVoice] = 0.0;
+	dSyncStep[nVoice] = 0.0;
+}
+
+const double *OscillatorBank::GetOutputs() const
+{
+	return dOutput;
+}
+
+bankMaster OscillatorBank::GetMaster() const
+{
+	bankMaster master = { dPhase, dIncrement, false };
+
+	return master;
+}
+
+//looks up the kernels for the current settings, only when they changed since the last frame
+void OscillatorBank::SelectKernel(const bankParams &params, bool bSync, int nSet)
+{
+	bool bMod = params.dPhaseOffset != 0.0;
+	uint32_t nKey = nSet | (params.nWave << 4) | (params.nEngine << 12) | (bMod << 16) | (bSync << 17) | ((params.dPulseWidth != 0.5) << 18);
+
+	if (nKey == nKernelKey)
+		return;
+
+	nKernelKey = nKey;
+	pVectorKernel = nullptr;
+	pScalarKernel = nullptr;
+
+	for (const bankWave &wave : waveKernels)
+	{
+		if (wave.nWave != params.nWave)
+			continue;
+
+		int nEngine = params.nEngine;
+
+		if (nEngine == OSC_TABLE && wave.bPulse && params.dPulseWidth != 0.5)
+			nEngine = BANK_PULSE;
+
+		pVectorKernel = wave.kernels[nSet][nEngine][bMod][bSync];
+		pScalarKernel = wave.kernels[SIMD_SCALAR][nEngine][bMod][bSync];
+	}
+}
+
+double OscillatorBank::Play(const bankParams &params, const double *pGains, const bankMaster *pMaster)
+{
+	int nSet = SIMDInstructionSet();
+
+	SelectKernel(params, pMaster != nullptr, nSet);
+
+	if (pScalarKernel == nullptr)
+		return 0.0;
+
+	//full vectors first, the remaining voices go through the scalar kernel
+	int nVector = nVoices - nVoices % SIMDWidth(nSet);
+	double dSum = 0.0;
+
+	if (nVector > 0)
+		dSum = (this->*pVectorKernel)(0, nVector, params, pGains, pMaster);
+
+	return dSum + (this->*pScalarKernel)(nVector, nVoices, params, pGains, pMaster);
+}
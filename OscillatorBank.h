@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#define BANK_MAX_VOICES 32
+
+//per frame settings shared by every voice of a bank, filled in by the owning Oscillator
+struct bankParams
+{
+	uint8_t nWave;
+	uint8_t nEngine;
+	double dPulseWidth;
+	double dPhaseOffset; //phase modulation in cycles
+	const float *pTable; //mip levels of the wave
+	const float *pSawTable; //saw mip levels, used for pulse widths other than 50%
+};
+
+//hard sync source, either one phase per voice or a single phase shared by all voices
+struct bankMaster
+{
+	const double *pPhase;
+	const double *pIncrement;
+	bool bBroadcast;
+};
+
+//Phases and increments of many voices stored as structure of arrays,
+//so one frame of several voices is rendered per SIMD instruction.
+class OscillatorBank
+{
+public:
+	OscillatorBank();
+	~OscillatorBank();
+
+	void SetVoiceCount(int nVoices);
+	int GetVoiceCount();
+	void SetVoice(int nVoice, double dIncrement); //increment in cycles per sample, mip levels are only looked up when it changes
+	void ResetVoice(int nVoice);
+	const double *GetOutputs() const; //every voice's weighted output of the last Play
+	bankMaster GetMaster() const; //this bank as hard sync source for another bank with the same voice layout
+
+	double Play(const bankParams &params, const double *pGains, const bankMaster *pMaster = nullptr); //renders one frame of every voice, returns the sum weighted by pGains
+
+	typedef double (OscillatorBank::*Kernel)(int nFirst, int nLast, const bankParams &params, const double *pGains, const bankMaster *pMaster);
+
+private:
+	friend struct bankKernels;
+
+	double dPhase[BANK_MAX_VOICES];
+	double dIncrement[BANK_MAX_VOICES];
+	double dInvIncrement[BANK_MAX_VOICES];
+	double dFade[BANK_MAX_VOICES];
+	double dSyncStep[BANK_MAX_VOICES];
+	double dSyncDistance[BANK_MAX_VOICES];
+	int32_t nLevelOffset[BANK_MAX_VOICES]; //start of the voice's mip level in the table data
+	int32_t nNextOffset[BANK_MAX_VOICES]; //start of the level it fades into
+	uint64_t nNoise[BANK_MAX_VOICES]; //xorshift state of every voice
+	double dPink[3][BANK_MAX_VOICES];
+	double dBrown[BANK_MAX_VOICES];
+	double dOutput[BANK_MAX_VOICES];
+
+	int nVoices;
+
+	//kernels specialized for the current wave, engine, modulation and sync
+	Kernel pVectorKernel;
+	Kernel pScalarKernel;
+	uint32_t nKernelKey;
+
+	void SelectKernel(const bankParams &params, bool bSync, int nSet);
+
+	template <class V, class W, int nEngine, bool bMod, bool bSync>
+	double Render(int nFirst, int nLast, const bankParams &params, const double *pGains, const bankMaster *pMaster);
+	template <class V, int nColor>
+	double RenderNoise(int nFirst, int nLast, const bankParams &params, const double *pGains, const bankMaster *pMaster);
+};
@@ -0,0 +1,84 @@
+#include "Oversampler.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+double Oversampler::dTaps2[HALFBAND_TAPS_2X];
+double Oversampler::dTaps4[HALFBAND_TAPS_4X];
+
+bool Oversampler::bDesigned = Design(dTaps2, HALFBAND_TAPS_2X, 8.0) && Design(dTaps4, HALFBAND_TAPS_4X, 8.0);
+
+Oversampler::Oversampler()
+{
+	up2.nPos = up4.nPos = down2.nPos = down4.nPos = 0;
+
+	for (int i = 0; i < OVERSAMPLE_LANES; i++)
+		Reset(i);
+}
+
+Oversampler::~Oversampler()
+{
+}
+
+void Oversampler::Reset(int nLane)
+{
+	if (nLane < 0 || nLane >= OVERSAMPLE_LANES)
+		return;
+
+	halfBandState *pStates[] = { &up2, &up4, &down2, &down4 };
+
+	for (halfBandState *pState : pStates)
+	{
+		for (int j = 0; j < 2 * HALFBAND_TAPS_2X; j++)
+			pState->dEven[j][nLane] = 0.0;
+
+		for (int j = 0; j < HALFBAND_TAPS_2X / 2; j++)
+			pState->dOdd[j][nLane] = 0.0;
+	}
+}
+
+//the 4x stages take two samples per frame, the 2x stages one
+void Oversampler::Next()
+{
+	up2.nPos = Slot(up2, HALFBAND_TAPS_2X, 0);
+	up4.nPos = Slot(up4, HALFBAND_TAPS_4X, 1);
+	down4.nPos = Slot(down4, HALFBAND_TAPS_4X, 1);
+	down2.nPos = Slot(down2, HALFBAND_TAPS_2X, 0);
+}
+
+//zeroth order modified bessel function of the first kind, for the kaiser window
+static double BesselI0(double x)
+{
+	double dSum = 1.0;
+	double dTerm = 1.0;
+
+	for (int k = 1; k < 32; k++)
+	{
+		dTerm *= (x / (2.0 * k)) * (x / (2.0 * k));
+		dSum += dTerm;
+	}
+
+	return dSum;
+}
+
+//kaiser windowed sinc with its cutoff at half nyquist, only the odd offsets from the center are kept
+bool Oversampler::Design(double *pTaps, int nTaps, double dBeta)
+{
+	int nCenter = nTaps - 1; //of the full filter, which is 2 * nTaps - 1 long
+	double dSum = 0.0;
+
+	for (int k = 0; k < nTaps; k++)
+	{
+		double d = 2 * k - nCenter; //odd
+		double r = d / (nCenter + 1);
+
+		pTaps[k] = 0.5 * sin(PI * d / 2.0) / (PI * d / 2.0) * BesselI0(dBeta * sqrt(1.0 - r * r)) / BesselI0(dBeta);
+		dSum += pTaps[k];
+	}
+
+	//the branch has to sum to 0.5 for unity gain at DC, together with the center tap
+	for (int k = 0; k < nTaps; k++)
+		pTaps[k] *= 0.5 / dSum;
+
+	return true;
+}
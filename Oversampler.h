@@ -0,0 +1,133 @@
+#pragma once
+
+#define OVERSAMPLE_LANES 32
+
+//taps of the filtering polyphase branch of each half-band stage, the full filters are 2 * n - 1 taps long
+//flat up to 0.4 of the base rate, images and aliases from 0.6 on are 60 dB down and 90 dB from 0.7 on
+#define HALFBAND_TAPS_2X 24 //base rate to 2x
+#define HALFBAND_TAPS_4X 8 //2x to 4x, the signal only fills the lower half so the transition can be wide
+
+//Half-band lowpass split into its polyphase branches. One branch is a pure delay (the center tap),
+//the other holds the nonzero taps, so up and downsampling by 2 only compute those.
+//Histories are stored per lane so a kernel can resample one SIMD vector of voices per call,
+//lanes are addressed by their first index like the banks' kernels do. The ring positions are shared by all lanes
+//and only move in Next, so any grouping of lanes into vectors reads the same offsets.
+class Oversampler
+{
+public:
+	Oversampler();
+	~Oversampler();
+
+	void Reset(int nLane); //clears the lane's histories
+	void Next(); //moves the rings on once every lane has been resampled for the frame
+
+	//nFactor (1, 2 or 4) samples at the raised rate from one sample, and back
+	template <class V, int nFactor>
+	void Up(int nLane, typename V::T x, typename V::T *pOut);
+	template <class V, int nFactor>
+	typename V::T Down(int nLane, const typename V::T *pIn);
+
+private:
+	//input histories as rings stored twice in a row, so the newest nTaps samples are always contiguous from the write position
+	struct halfBandState
+	{
+		double dEven[2 * HALFBAND_TAPS_2X][OVERSAMPLE_LANES]; //samples through the filtering branch
+		double dOdd[HALFBAND_TAPS_2X / 2][OVERSAMPLE_LANES]; //samples through the delay branch, downsampling only
+		int nPos; //last slot written in the previous frame
+	};
+
+	halfBandState up2, up4, down2, down4;
+
+	static double dTaps2[HALFBAND_TAPS_2X]; //filtering branch of each stage, designed at startup
+	static double dTaps4[HALFBAND_TAPS_4X];
+
+	static bool Design(double *pTaps, int nTaps, double dBeta);
+	static bool bDesigned;
+
+	static int Slot(const halfBandState &state, int nTaps, int nStep); //write position of the nStep-th sample this frame
+
+	template <class V, int nTaps>
+	static void UpStage(halfBandState &state, int nPos, int nLane, typename V::T x, typename V::T &y0, typename V::T &y1);
+	template <class V, int nTaps>
+	static typename V::T DownStage(halfBandState &state, int nPos, int nLane, typename V::T x0, typename V::T x1);
+};
+
+inline int Oversampler::Slot(const halfBandState &state, int nTaps, int nStep)
+{
+	return (state.nPos - 1 - nStep + 2 * nTaps) % nTaps;
+}
+
+//the filtering branch gives the even output, the delay branch the odd one
+template <class V, int nTaps>
+void Oversampler::UpStage(halfBandState &state, int nPos, int nLane, typename V::T x, typename V::T &y0, typename V::T &y1)
+{
+	typedef typename V::T T;
+
+	const double *pTaps = nTaps == HALFBAND_TAPS_2X ? dTaps2 : dTaps4;
+
+	V::Store(state.dEven[nPos] + nLane, x);
+	V::Store(state.dEven[nPos + nTaps] + nLane, x);
+
+	T acc = V::Mul(V::Set(pTaps[0]), x);
+
+	for (int j = 1; j < nTaps; j++)
+		acc = V::Add(acc, V::Mul(V::Set(pTaps[j]), V::Load(state.dEven[nPos + j] + nLane)));
+
+	y0 = V::Mul(V::Set(2.0), acc); //zero stuffing halves the level
+	y1 = V::Load(state.dEven[nPos + nTaps / 2 - 1] + nLane);
+}
+
+template <class V, int nTaps>
+typename V::T Oversampler::DownStage(halfBandState &state, int nPos, int nLane, typename V::T x0, typename V::T x1)
+{
+	typedef typename V::T T;
+
+	const double *pTaps = nTaps == HALFBAND_TAPS_2X ? dTaps2 : dTaps4;
+	int nOdd = nPos % (nTaps / 2); //a ring of nTaps / 2, its next slot holds the oldest sample
+
+	V::Store(state.dEven[nPos] + nLane, x0);
+	V::Store(state.dEven[nPos + nTaps] + nLane, x0);
+
+	T acc = V::Mul(V::Set(pTaps[0]), x0);
+
+	for (int j = 1; j < nTaps; j++)
+		acc = V::Add(acc, V::Mul(V::Set(pTaps[j]), V::Load(state.dEven[nPos + j] + nLane)));
+
+	//the center tap sees the odd sample from nTaps / 2 frames back
+	T odd = V::Load(state.dOdd[nOdd] + nLane);
+
+	V::Store(state.dOdd[nOdd] + nLane, x1);
+
+	return V::Add(acc, V::Mul(V::Set(0.5), odd));
+}
+
+template <class V, int nFactor>
+void Oversampler::Up(int nLane, typename V::T x, typename V::T *pOut)
+{
+	if (nFactor == 1)
+		pOut[0] = x;
+	else if (nFactor == 2)
+		UpStage<V, HALFBAND_TAPS_2X>(up2, Slot(up2, HALFBAND_TAPS_2X, 0), nLane, x, pOut[0], pOut[1]);
+	else
+	{
+		typename V::T a, b;
+
+		UpStage<V, HALFBAND_TAPS_2X>(up2, Slot(up2, HALFBAND_TAPS_2X, 0), nLane, x, a, b);
+		UpStage<V, HALFBAND_TAPS_4X>(up4, Slot(up4, HALFBAND_TAPS_4X, 0), nLane, a, pOut[0], pOut[1]);
+		UpStage<V, HALFBAND_TAPS_4X>(up4, Slot(up4, HALFBAND_TAPS_4X, 1), nLane, b, pOut[2], pOut[3]);
+	}
+}
+
+template <class V, int nFactor>
+typename V::T Oversampler::Down(int nLane, const typename V::T *pIn)
+{
+	if (nFactor == 1)
+		return pIn[0];
+	else if (nFactor == 2)
+		return DownStage<V, HALFBAND_TAPS_2X>(down2, Slot(down2, HALFBAND_TAPS_2X, 0), nLane, pIn[0], pIn[1]);
+
+	typename V::T a = DownStage<V, HALFBAND_TAPS_4X>(down4, Slot(down4, HALFBAND_TAPS_4X, 0), nLane, pIn[0], pIn[1]);
+	typename V::T b = DownStage<V, HALFBAND_TAPS_4X>(down4, Slot(down4, HALFBAND_TAPS_4X, 1), nLane, pIn[2], pIn[3]);
+
+	return DownStage<V, HALFBAND_TAPS_2X>(down2, Slot(down2, HALFBAND_TAPS_2X, 0), nLane, a, b);
+}
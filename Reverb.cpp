@@ -0,0 +1,375 @@
+#include "Reverb.h"
+#include "Oscillator.h"
+#include "SIMD.h"
+
+#include <chrono>
+
+static bool IsPrime(unsigned int n)
+{
+	if (n < 2)
+		return false;
+
+	for (unsigned int d = 2; d * d <= n; d++)
+	{
+		if (n % d == 0)
+			return false;
+	}
+
+	return true;
+}
+
+//+1 or -1, the sign of an entry of the sylvester hadamard matrix
+static double HadamardSign(unsigned int nRow, unsigned int nColumn)
+{
+	unsigned int nBits = nRow & nColumn;
+	bool bOdd = false;
+
+	while (nBits)
+	{
+		bOdd = !bOdd;
+		nBits &= nBits - 1;
+	}
+
+	return bOdd ? -1.0 : 1.0;
+}
+
+Reverb::Reverb()
+{
+	pLines = new double[REVERB_LINES * (REVERB_LINE_SIZE + 1)];
+
+	for (int i = 0; i < REVERB_LINES; i++)
+		dOffset[i] = (double)(i * (REVERB_LINE_SIZE + 1));
+
+	dLoad.store(0.0);
+	bChanged.store(false);
+
+	Update();
+	SetChannelGains(2);
+	Reset();
+}
+
+Reverb::~Reverb()
+{
+	delete[] pLines;
+}
+
+void Reverb::SetSampleRate(unsigned int nSampleRate)
+{
+	if (nSampleRate > REVERB_MAX_SAMPLE_RATE)
+		nSampleRate = REVERB_MAX_SAMPLE_RATE;
+
+	if (this->nSampleRate != nSampleRate)
+	{
+		this->nSampleRate = nSampleRate;
+		bChanged = true;
+	}
+}
+
+void Reverb::SetSize(double dSize)
+{
+	dSize = dSize < 0.25 ? 0.25 : (dSize > REVERB_MAX_SIZE ? REVERB_MAX_SIZE : dSize);
+
+	if (this->dSize != dSize)
+	{
+		this->dSize = dSize;
+		bChanged = true;
+	}
+}
+
+void Reverb::SetDecay(double dDecay)
+{
+	dDecay = dDecay < 0.1 ? 0.1 : dDecay;
+
+	if (this->dDecay != dDecay)
+	{
+		this->dDecay = dDecay;
+		bChanged = true;
+	}
+}
+
+void Reverb::SetDamping(double dDamping)
+{
+	dDamping = dDamping < 0.0 ? 0.0 : (dDamping > 1.0 ? 1.0 : dDamping);
+
+	if (this->dDamping != dDamping)
+	{
+		this->dDamping = dDamping;
+		bChanged = true;
+	}
+}
+
+void Reverb::SetMix(double dMix)
+{
+	this->dMix = dMix < 0.0 ? 0.0 : (dMix > 1.0 ? 1.0 : dMix);
+}
+
+void Reverb::SetMatrix(int nMatrix)
+{
+	if (this->nMatrix != nMatrix)
+	{
+		this->nMatrix = nMatrix;
+		bChanged = true;
+	}
+}
+
+void Reverb::SetModulation(double dDepth, double dRate)
+{
+	dDepth = dDepth < 0.0 ? 0.0 : (dDepth > REVERB_MAX_MODULATION ? REVERB_MAX_MODULATION : dDepth);
+
+	if (this->dDepth != dDepth || this->dRate != dRate)
+	{
+		this->dDepth = dDepth;
+		this->dRate = dRate;
+		bChanged = true;
+	}
+}
+
+double Reverb::GetSize()
+{
+	return dSize;
+}
+
+double Reverb::GetDecay()
+{
+	return dDecay;
+}
+
+double Reverb::GetDamping()
+{
+	return dDamping;
+}
+
+double Reverb::GetMix()
+{
+	return dMix;
+}
+
+int Reverb::GetMatrix()
+{
+	return nMatrix;
+}
+
+double Reverb::GetLoad()
+{
+	return dLoad.load();
+}
+
+void Reverb::Reset()
+{
+	for (int i = 0; i < REVERB_LINES * (REVERB_LINE_SIZE + 1); i++)
+		pLines[i] = 0.0;
+
+	//lfo phases spread around the circle so the lines never move together
+	for (int i = 0; i < REVERB_LINES; i++)
+	{
+		dDamp[i] = 0.0;
+		dCos[i] = cos(PI_R * i / REVERB_LINES);
+		dSin[i] = sin(PI_R * i / REVERB_LINES);
+	}
+
+	nWrite = 0;
+}
+
+void Reverb::Update()
+{
+	dModulation = dDepth * nSampleRate / 1000.0;
+
+	double dRatio = REVERB_MAX_LENGTH / REVERB_MIN_LENGTH;
+	unsigned int nMax = REVERB_LINE_SIZE - 4 - 2 * (unsigned int)ceil(dModulation);
+
+	for (int i = 0; i < REVERB_LINES; i++)
+	{
+		double dPosition = i / (double)(REVERB_LINES - 1);
+		unsigned int nLength = (unsigned int)(REVERB_MIN_LENGTH * pow(dRatio, dPosition) * dSize * nSampleRate / 1000.0);
+
+		//prime lengths share no common period, their echoes never pile up on the same sample
+		while (!IsPrime(nLength))
+			nLength++;
+
+		if (nLength > nMax)
+			nLength = nMax;
+
+		dLength[i] = nLength;
+
+		//gain per trip through the line for the decay time, including the mean modulation delay,
+		//the lowpass takes the nyquist gain down by the extra decay of the highs
+		double dTrip = (nLength + dModulation) / (dDecay * nSampleRate);
+		double dGain = pow(0.001, dTrip);
+		double dHigh = pow(0.001, dTrip * 19.0 * dDamping);
+
+		dPole[i] = (1.0 - dHigh) / (1.0 + dHigh);
+		dFeed[i] = dGain * (1.0 - dPole[i]);
+
+		double w = PI_R * dRate * (0.5 + dPosition) / nSampleRate;
+
+		dRotCos[i] = cos(w);
+		dRotSin[i] = sin(w);
+	}
+
+	//both matrices are orthogonal, the network only loses energy in the damping
+	for (int j = 0; j < REVERB_LINES; j++)
+	{
+		for (int i = 0; i < REVERB_LINES; i++)
+		{
+			if (nMatrix == REVERB_HOUSEHOLDER)
+				dMatrix[j][i] = (i == j ? 1.0 : 0.0) - 2.0 / REVERB_LINES;
+			else
+				dMatrix[j][i] = HadamardSign(i, j) / sqrt((double)REVERB_LINES);
+		}
+	}
+}
+
+//each channel feeds its share of the lines with alternating signs,
+//the outputs tap all lines through different hadamard rows so the channels are decorrelated
+void Reverb::SetChannelGains(unsigned int nChannels)
+{
+	double dIn = sqrt((double)nChannels / REVERB_LINES);
+
+	for (unsigned int c = 0; c < REVERB_CHANNELS; c++)
+	{
+		for (unsigned int i = 0; i < REVERB_LINES; i++)
+		{
+			if (c < nChannels && i % nChannels == c)
+				dInGain[c][i] = (i / nChannels) & 1 ? -dIn : dIn;
+			else
+				dInGain[c][i] = 0.0;
+
+			dOutGain[c][i] = HadamardSign(c + 1, i) / sqrt((double)REVERB_LINES);
+		}
+	}
+
+	nChannelGains = nChannels;
+}
+
+template <class V>
+void Reverb::Render(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	typedef typename V::T T;
+
+	T size = V::Set((double)REVERB_LINE_SIZE);
+	T depth = V::Set(dModulation);
+	T one = V::Set(1.0);
+	double dWrite[REVERB_LINES];
+
+	for (unsigned int f = 0; f < nFrames; f++)
+	{
+		double *pFrame = pBlock + f * nChannels;
+		T write = V::Set((double)(nWrite + REVERB_LINE_SIZE));
+		T in[REVERB_CHANNELS];
+		T sum[REVERB_CHANNELS];
+
+		for (unsigned int c = 0; c < nChannels; c++)
+		{
+			in[c] = V::Set(pFrame[c]);
+			sum[c] = V::Set(0.0);
+		}
+
+		//advance the lfos, read every line at its modulated length and damp it
+		for (int i = 0; i < REVERB_LINES; i += V::N)
+		{
+			T lfoCos = V::Load(dCos + i);
+			T lfoSin = V::Load(dSin + i);
+			T rotCos = V::Load(dRotCos + i);
+			T rotSin = V::Load(dRotSin + i);
+
+			V::Store(dCos + i, V::Sub(V::Mul(lfoCos, rotCos), V::Mul(lfoSin, rotSin)));
+			V::Store(dSin + i, V::Add(V::Mul(lfoSin, rotCos), V::Mul(lfoCos, rotSin)));
+
+			T pos = V::Sub(write, V::Add(V::Load(dLength + i), V::Mul(depth, V::Add(one, lfoSin))));
+			T n = V::Floor(pos);
+			T t = V::Sub(pos, n);
+			T v0, v1;
+
+			n = V::Select(V::Less(n, size), n, V::Sub(n, size));
+			V::Gather(pLines, V::Add(n, V::Load(dOffset + i)), v0, v1);
+
+			T x = V::Add(v0, V::Mul(t, V::Sub(v1, v0)));
+			T y = V::Add(V::Mul(V::Load(dFeed + i), x), V::Mul(V::Load(dPole + i), V::Load(dDamp + i)));
+
+			V::Store(dDamp + i, y);
+
+			for (unsigned int c = 0; c < nChannels; c++)
+				sum[c] = V::Add(sum[c], V::Mul(y, V::Load(dOutGain[c] + i)));
+		}
+
+		//mix the line outputs through the matrix and add the input
+		for (int i = 0; i < REVERB_LINES; i += V::N)
+		{
+			T w = V::Set(REVERB_DENORMAL);
+
+			for (unsigned int c = 0; c < nChannels; c++)
+				w = V::Add(w, V::Mul(in[c], V::Load(dInGain[c] + i)));
+
+			for (int j = 0; j < REVERB_LINES; j++)
+				w = V::Add(w, V::Mul(V::Set(dDamp[j]), V::Load(dMatrix[j] + i)));
+
+			V::Store(dWrite + i, w);
+		}
+
+		for (int i = 0; i < REVERB_LINES; i++)
+		{
+			double *pLine = pLines + i * (REVERB_LINE_SIZE + 1);
+
+			pLine[nWrite] = dWrite[i];
+
+			if (nWrite == 0)
+				pLine[REVERB_LINE_SIZE] = dWrite[i];
+		}
+
+		for (unsigned int c = 0; c < nChannels; c++)
+			pFrame[c] += dMix * (V::Sum(sum[c]) - pFrame[c]);
+
+		nWrite = (nWrite + 1) & (REVERB_LINE_SIZE - 1);
+	}
+
+	V::End();
+}
+
+struct reverbKernels
+{
+	static const Reverb::Kernel kernels[SIMD_AVX512 + 1];
+};
+
+const Reverb::Kernel reverbKernels::kernels[SIMD_AVX512 + 1] =
+{
+	&Reverb::Render<VecScalar>,
+	&Reverb::Render<VecSSE2>,
+	&Reverb::Render<VecAVX2>,
+	&Reverb::Render<VecAVX512>,
+};
+
+void Reverb::Process(double *pBlock, unsigned int nFrames, unsigned int nChannels)
+{
+	if (dMix <= 0.0 || nChannels > REVERB_CHANNELS)
+	{
+		dLoad.store(0.0);
+		return;
+	}
+
+	auto tStart = std::chrono::high_resolution_clock::now();
+
+	//a setter that runs during Update sets the flag again for the next block
+	if (bChanged.exchange(false))
+		Update();
+
+	if (nChannels != nChannelGains)
+		SetChannelGains(nChannels);
+
+	(this->*reverbKernels::kernels[SIMDInstructionSet()])(pBlock, nFrames, nChannels);
+
+	//pull the lfo phasors back onto the unit circle against rounding drift
+	for (int i = 0; i < REVERB_LINES; i++)
+	{
+		double k = 1.5 - 0.5 * (dCos[i] * dCos[i] + dSin[i] * dSin[i]);
+
+		dCos[i] *= k;
+		dSin[i] *= k;
+	}
+
+	//time spent against the real time the block lasts, smoothed over a few blocks
+	std::chrono::duration<double> tElapsed = std::chrono::high_resolution_clock::now() - tStart;
+	double dBlock = (double)nFrames / nSampleRate;
+
+	if (dBlock > 0.0)
+		dLoad.store(0.9 * dLoad.load() + 0.1 * tElapsed.count() / dBlock);
+}
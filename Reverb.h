@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+
+#define REVERB_LINES 16 //any power of two from 8 on, the hadamard matrix and the output taps are built for it
+#define REVERB_CHANNELS 4
+#define REVERB_MAX_SAMPLE_RATE 96000
+#define REVERB_LINE_SIZE 32768 //power of two above the longest line at the highest rate and size, plus modulation
+#define REVERB_MIN_LENGTH 23.0 //ms of the shortest line at size 1, the others are spread exponentially up to the longest
+#define REVERB_MAX_LENGTH 97.0
+#define REVERB_MAX_SIZE 2.0
+#define REVERB_MAX_MODULATION 1.0 //ms
+#define REVERB_DENORMAL 1e-18 //tiny offset on the line inputs keeps decaying tails out of the slow denormal range
+
+//feedback matrices
+#define REVERB_HADAMARD 0 //every line feeds every other with equal weight, the densest echoes
+#define REVERB_HOUSEHOLDER 1 //each line mostly feeds itself, builds up density slower
+
+//Feedback delay network reverb. Every line has a prime length, a damping lowpass setting its decay
+//and a slowly modulated read position against metallic ringing.
+//The lines are processed together as vectors: modulation, reads, damping and the feedback matrix run in SIMD lanes,
+//only the writes into the lines are scalar. All memory is allocated in the constructor.
+class Reverb
+{
+public:
+	Reverb();
+	~Reverb();
+
+	void SetSampleRate(unsigned int nSampleRate); //up to REVERB_MAX_SAMPLE_RATE, nothing is allocated
+	void SetSize(double dSize); //scales all line lengths, 0.25 to REVERB_MAX_SIZE
+	void SetDecay(double dDecay); //seconds for the low frequencies to fall by 60 dB
+	void SetDamping(double dDamping); //0 keeps the highs as long as the lows, 1 makes them die 20 times faster
+	void SetMix(double dMix); //0 dry to 1 wet, 0 bypasses the reverb
+	void SetMatrix(int nMatrix);
+	void SetModulation(double dDepth, double dRate); //ms and Hz
+
+	double GetSize();
+	double GetDecay();
+	double GetDamping();
+	double GetMix();
+	int GetMatrix();
+	double GetLoad(); //share of the real time of recent blocks spent in Process, safe to read from any thread
+
+	void Reset();
+	void Process(double *pBlock, unsigned int nFrames, unsigned int nChannels); //interleaved, in place, blocks with more than REVERB_CHANNELS stay dry
+
+	typedef void (Reverb::*Kernel)(double *pBlock, unsigned int nFrames, unsigned int nChannels);
+
+private:
+	friend struct reverbKernels;
+
+	Reverb(const Reverb&) = delete;
+	Reverb &operator=(const Reverb&) = delete;
+
+	double *pLines; //REVERB_LINE_SIZE samples per line plus a copy of the first one, so interpolation never wraps
+	unsigned int nWrite = 0;
+	unsigned int nSampleRate = 44100;
+	unsigned int nChannelGains = 0; //channel count the input and output gains are set up for
+
+	double dSize = 1.0;
+	double dDecay = 2.0;
+	double dDamping = 0.5;
+	double dMix = 0.0;
+	int nMatrix = REVERB_HADAMARD;
+	double dDepth = 0.1;
+	double dRate = 0.7;
+	std::atomic<bool> bChanged; //set by the setters, taken by Process
+
+	double dModulation = 0.0; //depth in samples
+
+	//per line, in lanes
+	double dOffset[REVERB_LINES]; //start of the line in pLines
+	double dLength[REVERB_LINES]; //samples
+	double dFeed[REVERB_LINES]; //decay gain times the damping lowpass input coefficient
+	double dPole[REVERB_LINES]; //damping lowpass feedback
+	double dDamp[REVERB_LINES]; //damping lowpass state, the line outputs of the current frame
+	double dCos[REVERB_LINES]; //modulation lfos as rotating phasors
+	double dSin[REVERB_LINES];
+	double dRotCos[REVERB_LINES];
+	double dRotSin[REVERB_LINES];
+	double dMatrix[REVERB_LINES][REVERB_LINES]; //by column, the lines feeding back from line j are dMatrix[j]
+	double dInGain[REVERB_CHANNELS][REVERB_LINES];
+	double dOutGain[REVERB_CHANNELS][REVERB_LINES];
+
+	std::atomic<double> dLoad;
+
+	void Update();
+	void SetChannelGains(unsigned int nChannels);
+
+	template <class V>
+	void Render(double *pBlock, unsigned int nFrames, unsigned int nChannels);
+};
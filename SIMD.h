@@ -0,0 +1,354 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <intrin.h>
+
+//instruction sets a kernel can be dispatched to
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+
+//Thin wrappers around double precision vectors, so a kernel is written once as a template and instantiated per instruction set.
+//All wrappers perform the same operations in the same order, lanes only differ from the scalar version by rounding of library calls.
+//I holds one 64 bit integer per lane, Unit() maps its top 52 bits to a double in [-1, 1).
+struct VecScalar
+{
+	typedef double T;
+	typedef bool M;
+	enum { N = 1 };
+
+	static T Load(const double *p) { return *p; }
+	static void Store(double *p, T a) { *p = a; }
+	static T Set(double d) { return d; }
+	static T Add(T a, T b) { return a + b; }
+	static T Sub(T a, T b) { return a - b; }
+	static T Mul(T a, T b) { return a * b; }
+	static T Div(T a, T b) { return a / b; }
+	static T Min(T a, T b) { return a < b ? a : b; }
+	static T Max(T a, T b) { return a > b ? a : b; }
+	static T Abs(T a) { return fabs(a); }
+	static T Floor(T a) { return floor(a); }
+	static M Less(T a, T b) { return a < b; }
+	static M And(M a, M b) { return a && b; }
+	static T Select(M m, T a, T b) { return m ? a : b; }
+	static double Sum(T a) { return a; }
+
+	typedef uint64_t I;
+
+	static I LoadI(const uint64_t *p) { return *p; }
+	static void StoreI(uint64_t *p, I a) { *p = a; }
+	static I Xor(I a, I b) { return a ^ b; }
+	template <int n> static I ShiftLeft(I a) { return a << n; }
+	template <int n> static I ShiftRight(I a) { return a >> n; }
+
+	static T Unit(I a)
+	{
+		uint64_t nBits = (a >> 12) | 0x3FF0000000000000ULL;
+		double d;
+		memcpy(&d, &nBits, sizeof(d));
+
+		return 2.0 * d - 3.0;
+	}
+
+	//pTable[offset + index] and the sample after it, dIndex has to hold whole numbers
+	static void Gather(const float *pTable, const int32_t *pOffset, T dIndex, T &v0, T &v1)
+	{
+		int i = pOffset[0] + (int)dIndex;
+
+		v0 = pTable[i];
+		v1 = pTable[i + 1];
+	}
+
+	//pTable[index] and the entry after it, for tables of doubles
+	static void Gather(const double *pTable, T dIndex, T &v0, T &v1)
+	{
+		int i = (int)dIndex;
+
+		v0 = pTable[i];
+		v1 = pTable[i + 1];
+	}
+
+	static void End() {}
+};
+
+struct VecSSE2
+{
+	typedef __m128d T;
+	typedef __m128d M;
+	enum { N = 2 };
+
+	static T Load(const double *p) { return _mm_loadu_pd(p); }
+	static void Store(double *p, T a) { _mm_storeu_pd(p, a); }
+	static T Set(double d) { return _mm_set1_pd(d); }
+	static T Add(T a, T b) { return _mm_add_pd(a, b); }
+	static T Sub(T a, T b) { return _mm_sub_pd(a, b); }
+	static T Mul(T a, T b) { return _mm_mul_pd(a, b); }
+	static T Div(T a, T b) { return _mm_div_pd(a, b); }
+	static T Min(T a, T b) { return _mm_min_pd(a, b); }
+	static T Max(T a, T b) { return _mm_max_pd(a, b); }
+	static T Abs(T a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+	static M Less(T a, T b) { return _mm_cmplt_pd(a, b); }
+	static M And(M a, M b) { return _mm_and_pd(a, b); }
+	static T Select(M m, T a, T b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+
+	typedef __m128i I;
+
+	static I LoadI(const uint64_t *p) { return _mm_loadu_si128((const __m128i*)p); }
+	static void StoreI(uint64_t *p, I a) { _mm_storeu_si128((__m128i*)p, a); }
+	static I Xor(I a, I b) { return _mm_xor_si128(a, b); }
+	template <int n> static I ShiftLeft(I a) { return _mm_slli_epi64(a, n); }
+	template <int n> static I ShiftRight(I a) { return _mm_srli_epi64(a, n); }
+
+	static T Unit(I a)
+	{
+		T d = _mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(a, 12), _mm_set1_epi64x(0x3FF0000000000000LL)));
+
+		return _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(2.0), d), _mm_set1_pd(3.0));
+	}
+
+	//SSE2 has no rounding instruction, truncate and correct negative values (valid for |a| < 2^31)
+	static T Floor(T a)
+	{
+		T t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(a));
+
+		return _mm_sub_pd(t, _mm_and_pd(_mm_cmpgt_pd(t, a), _mm_set1_pd(1.0)));
+	}
+
+	static double Sum(T a)
+	{
+		double d[2];
+		_mm_storeu_pd(d, a);
+
+		return d[0] + d[1];
+	}
+
+	static void Gather(const float *pTable, const int32_t *pOffset, T dIndex, T &v0, T &v1)
+	{
+		__m128i vi = _mm_add_epi32(_mm_cvttpd_epi32(dIndex), _mm_loadl_epi64((const __m128i*)pOffset));
+		int i0 = _mm_cvtsi128_si32(vi);
+		int i1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(vi, 1));
+
+		v0 = _mm_set_pd(pTable[i1], pTable[i0]);
+		v1 = _mm_set_pd(pTable[i1 + 1], pTable[i0 + 1]);
+	}
+
+	static void Gather(const double *pTable, T dIndex, T &v0, T &v1)
+	{
+		__m128i vi = _mm_cvttpd_epi32(dIndex);
+		int i0 = _mm_cvtsi128_si32(vi);
+		int i1 = _mm_cvtsi128_si32(_mm_shuffle_epi32(vi, 1));
+
+		v0 = _mm_set_pd(pTable[i1], pTable[i0]);
+		v1 = _mm_set_pd(pTable[i1 + 1], pTable[i0 + 1]);
+	}
+
+	static void End() {}
+};
+
+struct VecAVX2
+{
+	typedef __m256d T;
+	typedef __m256d M;
+	enum { N = 4 };
+
+	static T Load(const double *p) { return _mm256_loadu_pd(p); }
+	static void Store(double *p, T a) { _mm256_storeu_pd(p, a); }
+	static T Set(double d) { return _mm256_set1_pd(d); }
+	static T Add(T a, T b) { return _mm256_add_pd(a, b); }
+	static T Sub(T a, T b) { return _mm256_sub_pd(a, b); }
+	static T Mul(T a, T b) { return _mm256_mul_pd(a, b); }
+	static T Div(T a, T b) { return _mm256_div_pd(a, b); }
+	static T Min(T a, T b) { return _mm256_min_pd(a, b); }
+	static T Max(T a, T b) { return _mm256_max_pd(a, b); }
+	static T Abs(T a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+	static T Floor(T a) { return _mm256_floor_pd(a); }
+	static M Less(T a, T b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static M And(M a, M b) { return _mm256_and_pd(a, b); }
+	static T Select(M m, T a, T b) { return _mm256_blendv_pd(b, a, m); }
+
+	typedef __m256i I;
+
+	static I LoadI(const uint64_t *p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static void StoreI(uint64_t *p, I a) { _mm256_storeu_si256((__m256i*)p, a); }
+	static I Xor(I a, I b) { return _mm256_xor_si256(a, b); }
+	template <int n> static I ShiftLeft(I a) { return _mm256_slli_epi64(a, n); }
+	template <int n> static I ShiftRight(I a) { return _mm256_srli_epi64(a, n); }
+
+	static T Unit(I a)
+	{
+		T d = _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(a, 12), _mm256_set1_epi64x(0x3FF0000000000000LL)));
+
+		return _mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), d), _mm256_set1_pd(3.0));
+	}
+
+	static double Sum(T a)
+	{
+		double d[4];
+		_mm256_storeu_pd(d, a);
+
+		return d[0] + d[1] + d[2] + d[3];
+	}
+
+	static void Gather(const float *pTable, const int32_t *pOffset, T dIndex, T &v0, T &v1)
+	{
+		__m128i vi = _mm_add_epi32(_mm256_cvttpd_epi32(dIndex), _mm_loadu_si128((const __m128i*)pOffset));
+
+		v0 = _mm256_cvtps_pd(_mm_i32gather_ps(pTable, vi, 4));
+		v1 = _mm256_cvtps_pd(_mm_i32gather_ps(pTable + 1, vi, 4));
+	}
+
+	static void Gather(const double *pTable, T dIndex, T &v0, T &v1)
+	{
+		__m128i vi = _mm256_cvttpd_epi32(dIndex);
+
+		v0 = _mm256_i32gather_pd(pTable, vi, 8);
+		v1 = _mm256_i32gather_pd(pTable + 1, vi, 8);
+	}
+
+	static void End() { _mm256_zeroupper(); } //avoid AVX/SSE transition stalls in the code that follows
+};
+
+struct VecAVX512
+{
+	typedef __m512d T;
+	typedef __mmask8 M;
+	enum { N = 8 };
+
+	static T Load(const double *p) { return _mm512_loadu_pd(p); }
+	static void Store(double *p, T a) { _mm512_storeu_pd(p, a); }
+	static T Set(double d) { return _mm512_set1_pd(d); }
+	static T Add(T a, T b) { return _mm512_add_pd(a, b); }
+	static T Sub(T a, T b) { return _mm512_sub_pd(a, b); }
+	static T Mul(T a, T b) { return _mm512_mul_pd(a, b); }
+	static T Div(T a, T b) { return _mm512_div_pd(a, b); }
+	static T Min(T a, T b) { return _mm512_min_pd(a, b); }
+	static T Max(T a, T b) { return _mm512_max_pd(a, b); }
+	static T Abs(T a) { return _mm512_castsi512_pd(_mm512_and_epi64(_mm512_castpd_si512(a), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL))); }
+	static T Floor(T a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+	static M Less(T a, T b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static M And(M a, M b) { return (M)(a & b); }
+	static T Select(M m, T a, T b) { return _mm512_mask_blend_pd(m, b, a); }
+
+	typedef __m512i I;
+
+	static I LoadI(const uint64_t *p) { return _mm512_loadu_si512(p); }
+	static void StoreI(uint64_t *p, I a) { _mm512_storeu_si512(p, a); }
+	static I Xor(I a, I b) { return _mm512_xor_si512(a, b); }
+	template <int n> static I ShiftLeft(I a) { return _mm512_slli_epi64(a, n); }
+	template <int n> static I ShiftRight(I a) { return _mm512_srli_epi64(a, n); }
+
+	static T Unit(I a)
+	{
+		T d = _mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(a, 12), _mm512_set1_epi64(0x3FF0000000000000LL)));
+
+		return _mm512_sub_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), d), _mm512_set1_pd(3.0));
+	}
+
+	static double Sum(T a)
+	{
+		double d[8];
+		_mm512_storeu_pd(d, a);
+
+		return d[0] + d[1] + d[2] + d[3] + d[4] + d[5] + d[6] + d[7];
+	}
+
+	static void Gather(const float *pTable, const int32_t *pOffset, T dIndex, T &v0, T &v1)
+	{
+		__m256i vi = _mm256_add_epi32(_mm512_cvttpd_epi32(dIndex), _mm256_loadu_si256((const __m256i*)pOffset));
+
+		v0 = _mm512_cvtps_pd(_mm256_i32gather_ps(pTable, vi, 4));
+		v1 = _mm512_cvtps_pd(_mm256_i32gather_ps(pTable + 1, vi, 4));
+	}
+
+	static void Gather(const double *pTable, T dIndex, T &v0, T &v1)
+	{
+		__m256i vi = _mm512_cvttpd_epi32(dIndex);
+
+		v0 = _mm512_i32gather_pd(vi, pTable, 8);
+		v1 = _mm512_i32gather_pd(vi, pTable + 1, 8);
+	}
+
+	static void End() { _mm256_zeroupper(); }
+};
+
+//widest instruction set supported by both the CPU and the OS
+inline int SIMDDetectCPU()
+{
+	int info[4];
+
+	__cpuid(info, 0);
+	int nIds = info[0];
+
+	__cpuid(info, 1);
+	bool bSSE2 = (info[3] & (1 << 26)) != 0;
+	bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+	bool bAVX = (info[2] & (1 << 28)) != 0;
+
+	//the OS has to save the wider registers on context switches
+	unsigned long long nXCR0 = bOSXSAVE ? _xgetbv(0) : 0;
+	bool bOSAVX = (nXCR0 & 0x06) == 0x06;
+	bool bOSAVX512 = (nXCR0 & 0xE6) == 0xE6;
+
+	bool bAVX2 = false;
+	bool bAVX512 = false;
+
+	if (nIds >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		bAVX2 = (info[1] & (1 << 5)) != 0;
+		bAVX512 = (info[1] & (1 << 16)) != 0;
+	}
+
+	if (bAVX512 && bOSAVX512)
+		return SIMD_AVX512;
+	else if (bAVX && bAVX2 && bOSAVX)
+		return SIMD_AVX2;
+	else if (bSSE2)
+		return SIMD_SSE2;
+
+	return SIMD_SCALAR;
+}
+
+inline int SIMDDetect()
+{
+	static const int nSet = SIMDDetectCPU();
+
+	return nSet;
+}
+
+//instruction set every kernel table is indexed with, the detected one unless forced
+inline int &SIMDSelected()
+{
+	static int nSet = SIMDDetect();
+
+	return nSet;
+}
+
+//forces the kernels of every SIMD class at once, e.g. to scalar to compare against, limited to what the CPU supports
+inline void SIMDSetInstructionSet(int nSet)
+{
+	int nSupported = SIMDDetect();
+
+	if (nSet < SIMD_SCALAR)
+		nSet = SIMD_SCALAR;
+	else if (nSet > nSupported)
+		nSet = nSupported;
+
+	SIMDSelected() = nSet;
+}
+
+inline int SIMDInstructionSet()
+{
+	return SIMDSelected();
+}
+
+//doubles per vector of an instruction set
+inline int SIMDWidth(int nSet)
+{
+	static const int nWidth[SIMD_AVX512 + 1] = { VecScalar::N, VecSSE2::N, VecAVX2::N, VecAVX512::N };
+
+	return nWidth[nSet];
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+
+#define SPSC_CACHE_LINE 64
+
+//Wait-free ring buffer for exactly one producer thread and one consumer thread.
+//Capacity is rounded up to a power of two and allocated once at construction.
+template <typename T>
+class SPSCQueue
+{
+public:
+	SPSCQueue(unsigned int nCapacity = 64);
+	~SPSCQueue();
+
+	bool Push(const T &item); //producer only, returns false if the queue is full
+	bool Pop(T &item); //consumer only, returns false if the queue is empty
+	bool Empty() const;
+	unsigned int Size() const;
+	unsigned int Capacity() const;
+
+private:
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue &operator=(const SPSCQueue&) = delete;
+
+	T *pBuffer;
+	unsigned int nMask;
+
+	//head and tail live on separate cache lines so producer and consumer don't share one
+	char padHead[SPSC_CACHE_LINE];
+	std::atomic <unsigned int> nHead; //next slot to write, owned by the producer
+	char padTail[SPSC_CACHE_LINE];
+	std::atomic <unsigned int> nTail; //next slot to read, owned by the consumer
+	char padEnd[SPSC_CACHE_LINE];
+};
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(unsigned int nCapacity)
+{
+	unsigned int nSize = 1;
+
+	while (nSize < nCapacity)
+		nSize <<= 1;
+
+	pBuffer = new T[nSize];
+	nMask = nSize - 1;
+	nHead = 0;
+	nTail = 0;
+}
+
+template <typename T>
+SPSCQueue<T>::~SPSCQueue()
+{
+	delete[] pBuffer;
+}
+
+template <typename T>
+bool SPSCQueue<T>::Push(const T &item)
+{
+	unsigned int nWrite = nHead.load(std::memory_order_relaxed);
+
+	if (nWrite - nTail.load(std::memory_order_acquire) > nMask)
+		return false;
+
+	pBuffer[nWrite & nMask] = item;
+	nHead.store(nWrite + 1, std::memory_order_release);
+
+	return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::Pop(T &item)
+{
+	unsigned int nRead = nTail.load(std::memory_order_relaxed);
+
+	if (nRead == nHead.load(std::memory_order_acquire))
+		return false;
+
+	item = pBuffer[nRead & nMask];
+	nTail.store(nRead + 1, std::memory_order_release);
+
+	return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::Empty() const
+{
+	return nHead.load(std::memory_order_acquire) == nTail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+unsigned int SPSCQueue<T>::Size() const
+{
+	return nHead.load(std::memory_order_acquire) - nTail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+unsigned int SPSCQueue<T>::Capacity() const
+{
+	return nMask + 1;
+}
@@ -0,0 +1,299 @@
+#include "VoicePool.h"
+
+#include <thread>
+
+VoicePool::VoicePool() : events(VOICE_EVENTS), nPolyphony(16), nStealMode(VOICE_STEAL_OLDEST)
+{
+}
+
+VoicePool::~VoicePool()
+{
+}
+
+//events held back by a full queue go first, so they stay in order with the ones after them
+void VoicePool::Push(const voiceEvent &event)
+{
+	Flush();
+
+	bool bQueued = !bReleasePending && events.Push(event);
+
+	for (int i = 0; i < 10 && !bQueued && !bReleasePending; i++)
+	{
+		std::this_thread::yield();
+		bQueued = events.Push(event);
+	}
+
+	if (!bQueued)
+	{
+		nDropped++;
+
+		if (event.nType == VOICE_NOTE_OFF || event.nType == VOICE_ALL_OFF)
+			bReleasePending = true;
+		else if (event.nType == VOICE_ENVELOPE)
+		{
+			pendingEnvelope = event.envelope;
+			bEnvelopePending = true;
+		}
+	}
+}
+
+void VoicePool::Flush()
+{
+	if (bReleasePending)
+	{
+		voiceEvent event;
+		event.nType = VOICE_ALL_OFF;
+
+		bReleasePending = !events.Push(event);
+	}
+
+	if (bEnvelopePending && !bReleasePending)
+	{
+		voiceEvent event;
+		event.nType = VOICE_ENVELOPE;
+		event.envelope = pendingEnvelope;
+
+		bEnvelopePending = !events.Push(event);
+	}
+}
+
+unsigned int VoicePool::GetDroppedEvents()
+{
+	return nDropped;
+}
+
+void VoicePool::NoteOn(uint8_t nNote)
+{
+	voiceEvent event;
+	event.nType = VOICE_NOTE_ON;
+	event.nNote = nNote;
+
+	Push(event);
+}
+
+void VoicePool::NoteOff(uint8_t nNote)
+{
+	voiceEvent event;
+	event.nType = VOICE_NOTE_OFF;
+	event.nNote = nNote;
+
+	Push(event);
+}
+
+void VoicePool::AllNotesOff()
+{
+	voiceEvent event;
+	event.nType = VOICE_ALL_OFF;
+
+	Push(event);
+}
+
+void VoicePool::SetEnvelope(const EnvelopeParameters &envelope)
+{
+	voiceEvent event;
+	event.nType = VOICE_ENVELOPE;
+	event.envelope = envelope;
+
+	Push(event);
+}
+
+void VoicePool::SetPolyphony(int nPolyphony)
+{
+	if (nPolyphony < 1)
+		nPolyphony = 1;
+	else if (nPolyphony > VOICE_MAX)
+		nPolyphony = VOICE_MAX;
+
+	this->nPolyphony.store(nPolyphony);
+}
+
+void VoicePool::SetStealMode(int nMode)
+{
+	nStealMode.store(nMode);
+}
+
+int VoicePool::GetPolyphony()
+{
+	return nPolyphony.load();
+}
+
+int VoicePool::GetStealMode()
+{
+	return nStealMode.load();
+}
+
+void VoicePool::SetSampleRate(unsigned int nSampleRate)
+{
+	this->nSampleRate = nSampleRate;
+
+	for (int i = 0; i < VOICE_MAX; i++)
+		voices[i].envelope.SetSampleRate(nSampleRate);
+}
+
+void VoicePool::ProcessEvents()
+{
+	voiceEvent event;
+
+	Collect();
+
+	while (events.Pop(event))
+	{
+		switch (event.nType)
+		{
+		case VOICE_NOTE_ON:
+			Start(event.nNote);
+			break;
+		case VOICE_NOTE_OFF:
+			Release(event.nNote);
+			break;
+		case VOICE_ALL_OFF:
+			for (int i = 0; i < VOICE_MAX; i++)
+			{
+				if (voices[i].bHeld)
+					Release(voices[i].nNote);
+			}
+			break;
+		case VOICE_ENVELOPE:
+			envelope = event.envelope;
+
+			for (int i = 0; i < VOICE_MAX; i++)
+				voices[i].envelope.SetParameters(envelope);
+			break;
+		}
+	}
+}
+
+void VoicePool::Start(uint8_t nNote)
+{
+	int nVoice = -1;
+
+	//a note that is still sounding is retriggered on its own voice
+	for (int i = 0; i < VOICE_MAX && nVoice < 0; i++)
+	{
+		if (voices[i].bActive && voices[i].nNote == nNote)
+			nVoice = i;
+	}
+
+	if (nVoice < 0)
+		nVoice = Allocate();
+
+	Voice &voice = voices[nVoice];
+
+	if (!voice.bActive || voice.nNote != nNote)
+		filter.ResetVoice(nVoice);
+
+	voice.nNote = nNote;
+	voice.bActive = true;
+	voice.bHeld = true;
+	voice.bStarted = true;
+	voice.bFinished = false;
+	voice.nAge = nAllocations++;
+	voice.envelope.StartEnvelope();
+
+	if (nVoice >= nVoiceCount)
+		nVoiceCount = nVoice + 1;
+}
+
+void VoicePool::Release(uint8_t nNote)
+{
+	for (int i = 0; i < VOICE_MAX; i++)
+	{
+		if (voices[i].bHeld && voices[i].nNote == nNote)
+		{
+			voices[i].bHeld = false;
+			voices[i].envelope.StopEnvelope();
+		}
+	}
+}
+
+//lowest free voice within the polyphony, otherwise a voice is stolen.
+//Released voices are stolen before held ones, then the oldest or quietest goes.
+int VoicePool::Allocate()
+{
+	int nLimit = nPolyphony.load(std::memory_order_relaxed);
+	int nMode = nStealMode.load(std::memory_order_relaxed);
+
+	for (int i = 0; i < nLimit; i++)
+	{
+		if (!voices[i].bActive)
+			return i;
+	}
+
+	int nVictim = 0;
+
+	for (int i = 1; i < nLimit; i++)
+	{
+		Voice &a = voices[i];
+		Voice &b = voices[nVictim];
+
+		if (a.bHeld != b.bHeld)
+		{
+			if (!a.bHeld)
+				nVictim = i;
+		}
+		else if (nMode == VOICE_STEAL_QUIETEST)
+		{
+			if (a.envelope.GetAmplitude() < b.envelope.GetAmplitude())
+				nVictim = i;
+		}
+		else if (a.nAge < b.nAge)
+			nVictim = i;
+	}
+
+	return nVictim;
+}
+
+//frees the voices whose envelope ended during the last block
+void VoicePool::Collect()
+{
+	int nCount = 0;
+
+	for (int i = 0; i < nVoiceCount; i++)
+	{
+		Voice &voice = voices[i];
+
+		if (voice.bFinished)
+		{
+			voice.bActive = false;
+			voice.bFinished = false;
+		}
+
+		if (voice.bActive)
+			nCount = i + 1;
+	}
+
+	nVoiceCount = nCount;
+}
+
+void VoicePool::Render(unsigned int nFrames)
+{
+	Collect();
+
+	for (int i = 0; i < nVoiceCount; i++)
+	{
+		Voice &voice = voices[i];
+
+		if (!voice.bActive)
+			continue;
+
+		voice.envelope.Process(voice.dEnvelope, nFrames);
+
+		//the voice keeps its slot until the block that played the end of the release is done
+		voice.bFinished = !voice.envelope.IsActive();
+	}
+}
+
+int VoicePool::GetVoiceCount()
+{
+	return nVoiceCount;
+}
+
+Voice &VoicePool::GetVoice(int nVoice)
+{
+	return voices[nVoice];
+}
+
+FilterBank &VoicePool::GetFilter()
+{
+	return filter;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "Envelope.h"
+#include "FilterBank.h"
+#include "OscillatorBank.h"
+#include "SPSCQueue.h"
+
+#define VOICE_MAX BANK_MAX_VOICES //voice n plays voice n of every oscillator bank
+#define VOICE_EVENTS 256
+#define VOICE_BLOCK 64 //frames of envelope computed at once
+
+//which voice gives way when every voice is busy
+#define VOICE_STEAL_OLDEST 0
+#define VOICE_STEAL_QUIETEST 1
+
+//events from the GUI thread to the audio thread
+#define VOICE_NOTE_ON 0
+#define VOICE_NOTE_OFF 1
+#define VOICE_ALL_OFF 2
+#define VOICE_ENVELOPE 3
+
+struct voiceEvent
+{
+	uint8_t nType = VOICE_NOTE_ON;
+	uint8_t nNote = 0;
+	EnvelopeParameters envelope;
+};
+
+struct Voice
+{
+	uint8_t nNote = 0;
+	bool bActive = false; //playing, including the release tail
+	bool bHeld = false; //key still down
+	bool bStarted = false; //(re)triggered by the last ProcessEvents, the oscillator phases need a reset
+	bool bFinished = false; //the envelope ended during the last block
+	uint64_t nAge = 0; //allocation order, lower is older
+
+	Envelope envelope;
+	double dEnvelope[VOICE_BLOCK]; //envelope levels of the current block
+};
+
+//Fixed set of voices, allocated up front so the audio thread never reallocates.
+//Note events are queued by the GUI thread and applied by the audio thread in ProcessEvents.
+//When the queue stays full, note ons are dropped and counted. A lost note off turns into an all notes off
+//and a lost envelope is kept, both are queued ahead of the next event or by Flush, so no note hangs.
+class VoicePool
+{
+public:
+	VoicePool();
+	~VoicePool();
+
+	//GUI thread
+	void NoteOn(uint8_t nNote);
+	void NoteOff(uint8_t nNote);
+	void AllNotesOff();
+	void SetEnvelope(const EnvelopeParameters &envelope);
+	void SetPolyphony(int nPolyphony); //1 to VOICE_MAX
+	void SetStealMode(int nMode);
+	int GetPolyphony();
+	int GetStealMode();
+	void Flush(); //queues what a full queue held back, call regularly
+	unsigned int GetDroppedEvents(); //events that could not be queued
+
+	//audio thread
+	void SetSampleRate(unsigned int nSampleRate);
+	void ProcessEvents();
+	void Render(unsigned int nFrames); //envelopes of the next nFrames (up to VOICE_BLOCK) frames of every voice
+	int GetVoiceCount(); //one past the highest active voice
+	Voice &GetVoice(int nVoice);
+	FilterBank &GetFilter(); //lane n filters voice n, cleared whenever the voice starts a new note
+
+private:
+	Voice voices[VOICE_MAX];
+	FilterBank filter;
+	SPSCQueue<voiceEvent> events;
+	EnvelopeParameters envelope;
+	unsigned int nSampleRate = 44100;
+
+	std::atomic<int> nPolyphony;
+	std::atomic<int> nStealMode;
+
+	//GUI thread only
+	bool bReleasePending = false;
+	bool bEnvelopePending = false;
+	EnvelopeParameters pendingEnvelope;
+	unsigned int nDropped = 0;
+	uint64_t nAllocations = 0;
+	int nVoiceCount = 0;
+
+	void Collect();
+	void Start(uint8_t nNote);
+	void Release(uint8_t nNote);
+	int Allocate();
+	void Push(const voiceEvent &event);
+};
@@ -0,0 +1,147 @@
+#include "WaveFile.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+//little endian fields, independent of the host's byte order
+static uint32_t ReadLE(const unsigned char *p, int nBytes)
+{
+	uint32_t n = 0;
+
+	for (int i = nBytes - 1; i >= 0; i--)
+		n = (n << 8) | p[i];
+
+	return n;
+}
+
+static double DecodeSample(const unsigned char *p, int nFormat, int nBits)
+{
+	if (nFormat == WAVE_FORMAT_FLOAT)
+	{
+		if (nBits == 64)
+		{
+			uint64_t nRaw = ((uint64_t)ReadLE(p + 4, 4) << 32) | ReadLE(p, 4);
+			double d;
+			memcpy(&d, &nRaw, sizeof(d));
+
+			return d;
+		}
+
+		uint32_t nRaw = ReadLE(p, 4);
+		float f;
+		memcpy(&f, &nRaw, sizeof(f));
+
+		return f;
+	}
+
+	if (nBits == 8)
+		return (p[0] - 128) / 128.0; //8 bit is the only unsigned pcm
+
+	//sign extend from the top byte
+	int nBytes = nBits / 8;
+	int64_t n = (int64_t)ReadLE(p, nBytes);
+
+	if (n & ((int64_t)1 << (nBits - 1)))
+		n -= (int64_t)1 << nBits;
+
+	return n / (double)((int64_t)1 << (nBits - 1));
+}
+
+bool LoadWave(const std::string &sPath, std::vector<std::vector<double>> &channels, unsigned int &nSampleRate, double dMaxLength, unsigned int nMargin)
+{
+	std::ifstream file(sPath, std::ios::binary);
+	unsigned char header[12];
+
+	if (!file.read((char*)header, 12) || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+		return false;
+
+	//chunk sizes are clamped to what the file holds, a corrupt header can't make us allocate more
+	file.seekg(0, std::ios::end);
+	uint64_t nFileSize = (uint64_t)file.tellg();
+	file.seekg(12, std::ios::beg);
+
+	int nFormat = 0;
+	int nChannels = 0;
+	int nBits = 0;
+	int nBlockAlign = 0;
+	std::vector<unsigned char> data;
+	bool bFormat = false;
+	bool bData = false;
+
+	unsigned char chunk[8];
+
+	while (!bData && file.read((char*)chunk, 8))
+	{
+		uint32_t nSize = ReadLE(chunk + 4, 4);
+		uint64_t nLeft = nFileSize - (uint64_t)file.tellg();
+
+		if (nSize > nLeft)
+			nSize = (uint32_t)nLeft;
+
+		if (memcmp(chunk, "fmt ", 4) == 0)
+		{
+			std::vector<unsigned char> fmt(nSize < 40 ? 40 : nSize, 0);
+
+			if (nSize < 16 || !file.read((char*)fmt.data(), nSize))
+				return false;
+
+			nFormat = ReadLE(&fmt[0], 2);
+			nChannels = ReadLE(&fmt[2], 2);
+			nSampleRate = ReadLE(&fmt[4], 4);
+			nBlockAlign = ReadLE(&fmt[12], 2);
+			nBits = ReadLE(&fmt[14], 2);
+
+			//the real format is the start of the sub format guid
+			if (nFormat == WAVE_FORMAT_EXTENSIBLE && nSize >= 26)
+				nFormat = ReadLE(&fmt[24], 2);
+
+			bFormat = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0)
+		{
+			//only the frames asked for, the format comes before the data in any file we can decode
+			if (dMaxLength > 0.0 && bFormat && nBlockAlign > 0)
+			{
+				uint64_t nMaxBytes = ((uint64_t)ceil(dMaxLength * nSampleRate) + nMargin) * nBlockAlign;
+
+				if (nSize > nMaxBytes)
+					nSize = (uint32_t)nMaxBytes;
+			}
+
+			data.resize(nSize);
+			file.read((char*)data.data(), nSize);
+			data.resize((size_t)file.gcount()); //a truncated file keeps what is there
+			bData = true;
+		}
+		else
+			file.seekg(nSize, std::ios::cur);
+
+		//chunks are padded to an even length
+		if (!bData && (nSize & 1))
+			file.seekg(1, std::ios::cur);
+	}
+
+	bool bPCM = nFormat == WAVE_FORMAT_PCM && (nBits == 8 || nBits == 16 || nBits == 24 || nBits == 32);
+	bool bFloat = nFormat == WAVE_FORMAT_FLOAT && (nBits == 32 || nBits == 64);
+
+	if (!bFormat || !bData || (!bPCM && !bFloat) || nChannels < 1 || nSampleRate == 0 || nBlockAlign < nChannels * nBits / 8)
+		return false;
+
+	size_t nFrames = data.size() / nBlockAlign;
+
+	channels.assign(nChannels, std::vector<double>(nFrames));
+
+	for (size_t f = 0; f < nFrames; f++)
+	{
+		for (int c = 0; c < nChannels; c++)
+			channels[c][f] = DecodeSample(&data[f * nBlockAlign + c * nBits / 8], nFormat, nBits);
+	}
+
+	return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//Reads a RIFF wave file into one array per channel, scaled to -1..1.
+//Handles 8, 16, 24 and 32 bit PCM, 32 and 64 bit float and the extensible header around them.
+//Returns false if the file can't be opened or holds anything else.
+//With dMaxLength set only that many seconds plus nMargin frames are read, chunk sizes are never trusted past the end of the file.
+bool LoadWave(const std::string &sPath, std::vector<std::vector<double>> &channels, unsigned int &nSampleRate, double dMaxLength = 0.0, unsigned int nMargin = 0);
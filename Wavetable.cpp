@@ -0,0 +1,155 @@
+#include "Wavetable.h"
+#include "Oscillator.h"
+
+#include <cmath>
+
+Wavetable::Wavetable(uint8_t nWave)
+{
+	//a sine has no harmonics to drop, one level is enough
+	nLevels = (nWave == WAVE_SINE) ? 1 : WT_LEVELS;
+	pTable = new float[nLevels * (WT_SIZE + 1)];
+
+	Generate(nWave);
+}
+
+Wavetable::~Wavetable()
+{
+	delete[] pTable;
+}
+
+//additive synthesis of the fourier series, harmonics are read from one sine table so no sin() is needed per partial
+void Wavetable::Generate(uint8_t nWave)
+{
+	double *dSine = new double[WT_SIZE];
+	double *dLevel = new double[WT_SIZE];
+
+	for (int i = 0; i < WT_SIZE; i++)
+		dSine[i] = sin(PI_R * i / (double)WT_SIZE);
+
+	for (int l = 0; l < nLevels; l++)
+	{
+		int nHarmonics = (WT_SIZE >> (l + 1)) - (l == 0 ? 1 : 0); //level 0 stops below the table's own nyquist
+
+		for (int i = 0; i < WT_SIZE; i++)
+			dLevel[i] = 0.0;
+
+		for (int n = 1; n <= nHarmonics; n++)
+		{
+			double dAmp = 0.0;
+
+			switch (nWave)
+			{
+			case WAVE_SINE:
+				dAmp = (n == 1) ? 1.0 : 0.0;
+				break;
+			case WAVE_SQUARE:
+				dAmp = (n % 2) ? 4.0 / (PI * n) : 0.0;
+				break;
+			case WAVE_SAW:
+				dAmp = 2.0 / (PI * n);
+				break;
+			case WAVE_TRI:
+				dAmp = (n % 2) ? ((n % 4 == 1) ? 1.0 : -1.0) * 8.0 / (PI * PI * n * n) : 0.0;
+				break;
+			}
+
+			if (dAmp == 0.0)
+				continue;
+
+			for (int i = 0; i < WT_SIZE; i++)
+				dLevel[i] += dAmp * dSine[(n * i) & (WT_SIZE - 1)];
+		}
+
+		float *pLevel = pTable + l * (WT_SIZE + 1);
+
+		for (int i = 0; i < WT_SIZE; i++)
+			pLevel[i] = (float)dLevel[i];
+
+		pLevel[WT_SIZE] = pLevel[0];
+	}
+
+	delete[] dSine;
+	delete[] dLevel;
+}
+
+double Wavetable::Lookup(double dPhase, int nLevel, double dFade) const
+{
+	double dIndex = dPhase * WT_SIZE;
+	int nIndex = (int)dIndex;
+	double dFrac = dIndex - nIndex;
+
+	if (nLevel >= nLevels)
+	{
+		nLevel = nLevels - 1;
+		dFade = 0.0;
+	}
+
+	const float *pLevel = pTable + nLevel * (WT_SIZE + 1);
+	double dOut = pLevel[nIndex] + dFrac * (pLevel[nIndex + 1] - pLevel[nIndex]);
+
+	if (dFade > 0.0 && nLevel + 1 < nLevels)
+	{
+		pLevel += WT_SIZE + 1;
+		double dNext = pLevel[nIndex] + dFrac * (pLevel[nIndex + 1] - pLevel[nIndex]);
+
+		dOut += dFade * (dNext - dOut);
+	}
+
+	return dOut;
+}
+
+const float *Wavetable::GetData() const
+{
+	return pTable;
+}
+
+//picks the richest level that is alias free for dIncrement and a fade towards the next level,
+//the fade reaches the next level exactly where the current one would start aliasing
+void Wavetable::GetMipLevel(double dIncrement, int &nLevel, double &dFade)
+{
+	if (dIncrement <= 0.0)
+	{
+		nLevel = 0;
+		dFade = 0.0;
+		return;
+	}
+
+	double dOctave = log2(dIncrement) + WT_LEVELS;
+
+	if (dOctave <= -1.0)
+	{
+		nLevel = 0;
+		dFade = 0.0;
+	}
+	else if (dOctave > WT_LEVELS - 1)
+	{
+		nLevel = WT_LEVELS - 1;
+		dFade = 0.0;
+	}
+	else
+	{
+		nLevel = (int)ceil(dOctave);
+		dFade = dOctave - (nLevel - 1);
+	}
+}
+
+//first call builds every table, the oscillators' constructors make sure this happens before audio starts
+const Wavetable &Wavetable::Get(uint8_t nWave)
+{
+	static Wavetable sine(WAVE_SINE);
+	static Wavetable square(WAVE_SQUARE);
+	static Wavetable saw(WAVE_SAW);
+	static Wavetable tri(WAVE_TRI);
+
+	switch (nWave)
+	{
+	case WAVE_SQUARE:
+		return square;
+	case WAVE_SAW:
+		return saw;
+	case WAVE_TRI:
+		return tri;
+	default:
+		return sine;
+	}
+}
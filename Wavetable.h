@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#define WT_SIZE 4096 //samples per cycle in every mip level
+#define WT_LEVELS 12 //one level per octave, level n is alias free up to an increment of 2^(n-12) cycles per sample
+
+//Band limited single cycle tables with one mip level per octave.
+//Level 0 holds every harmonic the table size allows, each following level drops the top octave of harmonics.
+class Wavetable
+{
+public:
+	Wavetable(uint8_t nWave);
+	~Wavetable();
+
+	double Lookup(double dPhase, int nLevel, double dFade) const; //crossfades between nLevel and the next level
+	const float *GetData() const; //level l starts at l * (WT_SIZE + 1)
+
+	static void GetMipLevel(double dIncrement, int &nLevel, double &dFade);
+	static const Wavetable &Get(uint8_t nWave); //shared tables, generated on first use
+
+private:
+	Wavetable(const Wavetable&) = delete;
+	Wavetable &operator=(const Wavetable&) = delete;
+
+	void Generate(uint8_t nWave);
+
+	float *pTable; //WT_LEVELS tables of WT_SIZE + 1 samples, the last sample repeats the first for interpolation
+	int nLevels;
+};